@@ -0,0 +1,53 @@
+#ifndef ALIAS_TABLE_H
+#define ALIAS_TABLE_H
+
+#include <vector>
+
+// Walker's alias method, built with Vose's algorithm. Sampling a discrete distribution over n
+// outcomes becomes one uniform draw u in [0, n) and one table lookup:
+//   column = floor(u), pick column if fract(u) < probability[column], otherwise alias[column]
+// so weighted map selection costs the same as uniform selection and never branches on the
+// number of maps.
+struct AliasTable
+{
+    std::vector<float> probability;
+    std::vector<int> alias;
+
+    // weights need not be normalized; negative weights count as 0, all-zero means uniform
+    // ------------------------------------------------------------------------
+    void build(const std::vector<float> &weights)
+    {
+        unsigned int n = static_cast<unsigned int>(weights.size());
+        probability.assign(n, 1.0f);
+        alias.resize(n);
+        for(unsigned int k = 0; k < n; k++) alias[k] = k;
+        if(n == 0) return;
+
+        double total = 0.0;
+        for(float w : weights) total += w > 0.0f ? w : 0.0f;
+
+        std::vector<double> scaled(n);
+        std::vector<unsigned int> small, large;
+        for(unsigned int k = 0; k < n; k++){
+            double w = weights[k] > 0.0f ? weights[k] : 0.0f;
+            scaled[k] = total > 0.0 ? w * n / total : 1.0;
+            if(scaled[k] < 1.0) small.push_back(k);
+            else large.push_back(k);
+        }
+        while(!small.empty() && !large.empty()){
+            unsigned int s = small.back(); small.pop_back();
+            unsigned int l = large.back(); large.pop_back();
+            probability[s] = static_cast<float>(scaled[s]);
+            alias[s] = l;
+            scaled[l] = (scaled[l] + scaled[s]) - 1.0;
+            if(scaled[l] < 1.0) small.push_back(l);
+            else large.push_back(l);
+        }
+        // whatever is left is 1 up to rounding error
+        for(unsigned int k : large) probability[k] = 1.0f;
+        for(unsigned int k : small) probability[k] = 1.0f;
+    }
+
+    unsigned int size() const { return static_cast<unsigned int>(probability.size()); }
+};
+#endif
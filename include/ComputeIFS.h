@@ -0,0 +1,78 @@
+#ifndef COMPUTE_IFS_H
+#define COMPUTE_IFS_H
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <ComputeShader.h>
+#include <IFS.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+
+// Launches enough work groups of computeShader for `count` invocations along x. Above the
+// work group count limit (65535 on many drivers, Mesa's llvmpipe included) the groups are
+// spread over y as well, the shader flattens gl_GlobalInvocationID back into an index.
+// ------------------------------------------------------------------------
+inline void dispatch_points(const ComputeShader &computeShader, unsigned int count)
+{
+    // queried with the first dispatch, the limit does not change during the run
+    static const GLint max_groups = []{
+        GLint limit = 65535;
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &limit);
+        return limit;
+    }();
+    unsigned int local_size = computeShader.invocations();
+    unsigned int groups = (count + local_size - 1) / local_size;
+    unsigned int groups_x = std::min(groups, static_cast<unsigned int>(max_groups));
+    unsigned int groups_y = groups_x > 0 ? (groups + groups_x - 1) / groups_x : 0;
+    if(groups_x > 0) glDispatchCompute(groups_x, groups_y, 1);
+}
+
+// Uploads the maps and the alias table of an IFS to shaders/shader.comp and runs `iterations`
+// chaos-game steps over the positions bound to SSBO binding 0. By default the shader loops
+// over all iterations in a single dispatch; single_pass = false falls back to one dispatch
+// and memory barrier per iteration. Both draw the same random streams and give the same
+// result. seed is advanced once per call and then is the CounterRng seed of the call: the
+// shader picks exactly the maps iterate_blocked() picks with that seed. Shared by the
+// windowed app and the headless tools.
+//
+// A shader built with "#define SPLAT" also bins the last splat_iterations iterates of every
+// point into the density image at image unit 0 (max_hits at SSBO binding 1, the Camera block
+// and u_model set by the caller), in either mode.
+inline void compute_ifs_shader(ComputeShader &computeShader, const IFS &fractal, unsigned int number_of_points, unsigned int iterations, int &seed, bool single_pass = true, unsigned int splat_iterations = 0)
+{
+    computeShader.use();
+    GLint transform_array_location = computeShader.location("u_transformations[0]");
+    if(transform_array_location == -1){
+        std::cout << "Warning: uniform 'u_transformations[0]' not found (location = -1)." << std::endl;
+    } else {
+        glUniformMatrix4fv(transform_array_location, fractal.size(), GL_TRUE, glm::value_ptr(fractal.transforms()[0]));
+    }
+    glUniform1iv(computeShader.location("u_alias_probability[0]"), fractal.size(), fractal.table().alias_probability);
+    glUniform1iv(computeShader.location("u_alias_index[0]"), fractal.size(), fractal.table().alias_index);
+    computeShader.setInt("u_map_count", fractal.size());
+    glUniform1ui(computeShader.location("u_point_count"), number_of_points);
+    seed++;
+    unsigned int dispatches = single_pass ? 1 : iterations;
+    computeShader.setInt("u_iterations", single_pass ? iterations : 1);
+    glUniform1i(computeShader.location("u_seed"), seed);
+    GLint first_location = computeShader.location("u_first_iteration");
+    GLint splat_location = computeShader.location("u_splat_iterations");
+    splat_iterations = std::min(splat_iterations, iterations);
+    GLbitfield barriers = GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+    if(splat_location != -1) barriers |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT;
+    if(single_pass) glUniform1i(splat_location, static_cast<int>(splat_iterations));
+    for(unsigned int i = 0; i < dispatches; i++){
+        // the per-iteration dispatches draw the random streams of the single pass' steps
+        glUniform1i(first_location, static_cast<int>(i));
+        // one iteration per dispatch, only the last splat_iterations of them are binned
+        if(!single_pass) glUniform1i(splat_location, i + splat_iterations >= iterations ? 1 : 0);
+
+        dispatch_points(computeShader, number_of_points);
+        // Ensure writes to the SSBO are visible to subsequent vertex attribute fetches.
+        glMemoryBarrier(barriers);
+    }
+}
+#endif
@@ -4,7 +4,11 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <UniformLocations.h>
+#include <ProgramCache.h>
+
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -13,9 +17,12 @@ class ComputeShader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // local_size_x/y/z the program was linked with
+    GLint workGroupSize[3] = {1, 1, 1};
+    // constructor generates the shader on the fly; defines ("#define NAME value" lines) are
+    // inserted right after the #version line
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath)
+    ComputeShader(const char* computePath, const std::string &defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string computeCode;
@@ -39,21 +46,47 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
-        const char* cShaderCode = computeCode.c_str();
-        // 2. compile shaders
-        unsigned int compute;
-        // vertex shader
-        compute = glCreateShader(GL_COMPUTE_SHADER);
-        glShaderSource(compute, 1, &cShaderCode, NULL);
-        glCompileShader(compute);
-        checkCompileErrors(compute, "COMPUTE");
-        // shader Program
+        if(!defines.empty())
+        {
+            std::string::size_type version = computeCode.find("#version");
+            std::string::size_type line_end = version == std::string::npos ? 0 : computeCode.find('\n', version);
+            if(line_end == std::string::npos) line_end = computeCode.size();
+            else if(version != std::string::npos) line_end++;
+            computeCode.insert(line_end, defines);
+        }
+        // 2. reuse the program binary of an earlier run if the source and the driver match
         ID = glCreateProgram();
-        glAttachShader(ID, compute);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(compute);
+        std::string cacheKey = program_cache::key({ computeCode });
+        if(!program_cache::load(ID, cacheKey))
+        {
+            const char* cShaderCode = computeCode.c_str();
+            // 3. compile shaders
+            unsigned int compute;
+            // vertex shader
+            compute = glCreateShader(GL_COMPUTE_SHADER);
+            glShaderSource(compute, 1, &cShaderCode, NULL);
+            glCompileShader(compute);
+            checkCompileErrors(compute, "COMPUTE");
+            // shader Program
+            glAttachShader(ID, compute);
+            glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDeleteShader(compute);
+            program_cache::store(ID, cacheKey);
+        }
+        // every uniform location is looked up once here instead of on every set call
+        uniforms.reflect(ID);
+        GLint success;
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if(success) glGetProgramiv(ID, GL_COMPUTE_WORK_GROUP_SIZE, workGroupSize);
+    }
+
+    // number of invocations per work group
+    unsigned int invocations() const
+    {
+        return workGroupSize[0] * workGroupSize[1] * workGroupSize[2];
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -61,70 +94,82 @@ public:
     { 
         glUseProgram(ID); 
     }
+    // location of a uniform, -1 if the program has none by that name
+    GLint location(std::string_view name) const
+    {
+        return uniforms[name];
+    }
+    // handle for setting a uniform without any lookup, e.g. kept across frames
+    Uniform uniform(std::string_view name) const
+    {
+        return { ID, uniforms[name] };
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(std::string_view name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(uniforms[name], (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(std::string_view name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(uniforms[name], value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(std::string_view name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(uniforms[name], value); 
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(std::string_view name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform2fv(uniforms[name], 1, &value[0]); 
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(std::string_view name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        glUniform2f(uniforms[name], x, y); 
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(std::string_view name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform3fv(uniforms[name], 1, &value[0]); 
     }
-    void setVec3(const std::string &name, const float *values, const int &size) const
+    void setVec3(std::string_view name, const float *values, const int &size) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), size , values); 
+        glUniform3fv(uniforms[name], size , values); 
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(std::string_view name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        glUniform3f(uniforms[name], x, y, z); 
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(std::string_view name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        glUniform4fv(uniforms[name], 1, &value[0]); 
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) 
+    void setVec4(std::string_view name, float x, float y, float z, float w) 
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        glUniform4f(uniforms[name], x, y, z, w); 
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(std::string_view name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(uniforms[name], 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(std::string_view name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(uniforms[name], 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(std::string_view name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(uniforms[name], 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    UniformLocations uniforms;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
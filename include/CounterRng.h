@@ -0,0 +1,52 @@
+#ifndef COUNTER_RNG_H
+#define COUNTER_RNG_H
+
+#include <cstdint>
+
+// Counter-based random numbers for the chaos-game kernels. There is no generator state:
+// the random value of a point is a pure function of (seed, iteration, point index), so every
+// kernel - scalar, SIMD or split across any number of threads - draws exactly the same
+// numbers and a frame is reproducible from its seed alone.
+//
+// A sweep over the points first derives a 32 bit key from (seed, iteration), then each point
+// hashes its index with that key. The hash is the PCG RXS-M-XS output permutation, which only
+// needs multiplies, xors and per-lane shifts and therefore vectorizes directly.
+namespace rng
+{
+    const uint32_t PCG_MULTIPLIER = 747796405u;
+    const uint32_t PCG_INCREMENT  = 2891336453u;
+    const uint32_t PCG_OUTPUT     = 277803737u;
+    const uint32_t GOLDEN_RATIO   = 0x9E3779B9u;
+
+    inline uint32_t hash(uint32_t v)
+    {
+        uint32_t state = v * PCG_MULTIPLIER + PCG_INCREMENT;
+        uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * PCG_OUTPUT;
+        return (word >> 22u) ^ word;
+    }
+
+    // key of one sweep over all points, computed once per (seed, iteration)
+    inline uint32_t stream_key(uint32_t seed, uint32_t iteration)
+    {
+        return hash(seed ^ hash(iteration * GOLDEN_RATIO + PCG_INCREMENT));
+    }
+
+    // random value of point `index` in the sweep identified by `key`
+    inline uint32_t sample(uint32_t key, uint32_t index)
+    {
+        return hash(index ^ key);
+    }
+
+    // maps a random value to [0, n) from its high bits, without the bias of `% n`
+    inline unsigned int uniform_index(uint32_t r, unsigned int n)
+    {
+        return ((r >> 16) * n) >> 16;
+    }
+
+    // maps a random value to [0, 1) with 24 bits of precision
+    inline float unit(uint32_t r)
+    {
+        return (r >> 8) * (1.0f / 16777216.0f);
+    }
+}
+#endif
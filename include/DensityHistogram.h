@@ -0,0 +1,136 @@
+#ifndef DENSITY_HISTOGRAM_H
+#define DENSITY_HISTOGRAM_H
+
+#include <PointStore.h>
+#include <ThreadPool.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Flame-style accumulation buffer: every iterated point is projected to the screen and adds
+// one hit to its pixel instead of being rasterized as a GL_POINT. Tone-mapping the counts with
+// log density (see intensity()) keeps the structure of dense and sparse regions alike, where
+// plain point drawing saturates after the first hit.
+//
+// Rows are stored bottom-up like an OpenGL texture, so bins() uploads as-is to the R32UI
+// texture shaders/quad.fs samples. The class knows nothing about OpenGL and is shared with
+// the headless tools.
+class DensityHistogram
+{
+public:
+    // accumulation stops once a pixel reaches this count, so a progressive render left running
+    // converges instead of wrapping around (shader.comp splatting uses the same limit)
+    static const uint32_t SATURATION = 1u << 31;
+
+    DensityHistogram(unsigned int width = 0, unsigned int height = 0)
+    {
+        resize(width, height);
+    }
+
+    // clears the histogram when the size changes
+    // ------------------------------------------------------------------------
+    void resize(unsigned int new_width, unsigned int new_height)
+    {
+        if(new_width == width_ && new_height == height_ && bins_.size() == (size_t)width_ * height_) return;
+        width_ = new_width;
+        height_ = new_height;
+        bins_.assign((size_t)width_ * height_, 0);
+        worker_bins.clear();
+        max_hits_ = 0;
+        samples_ = 0;
+    }
+
+    void clear()
+    {
+        std::fill(bins_.begin(), bins_.end(), 0);
+        max_hits_ = 0;
+        samples_ = 0;
+    }
+
+    unsigned int width() const { return width_; }
+    unsigned int height() const { return height_; }
+    const uint32_t *bins() const { return bins_.data(); }
+    uint32_t hits(unsigned int x, unsigned int y) const { return bins_[(size_t)y * width_ + x]; }
+    // largest count of any pixel, the normalization of the tone mapping
+    uint32_t max_hits() const { return max_hits_; }
+    // number of points offered to accumulate() since the last clear, binned or not
+    uint64_t samples() const { return samples_; }
+
+    bool saturated() const { return max_hits_ >= SATURATION; }
+
+    // Projects points [begin, end) with mvp (clip space, as in shader.vs) and adds them to the
+    // counts. Worker 0 bins straight into the histogram, every other worker into private bins
+    // that are summed afterwards, so no atomics are needed and no cache line is shared between
+    // threads. Called repeatedly without clear() it accumulates frames progressively.
+    // ------------------------------------------------------------------------
+    void accumulate(ThreadPool &pool, const PointStore &points, unsigned int begin, unsigned int end, const glm::mat4 &mvp)
+    {
+        if(bins_.empty() || end <= begin || saturated()) return;
+        unsigned int workers = pool.size();
+        if(worker_bins.size() != workers - 1) worker_bins.assign(workers - 1, std::vector<uint32_t>(bins_.size(), 0));
+        pool.parallel_for(begin, end, PointStore::PADDING, [&](unsigned int start, unsigned int stop, unsigned int worker){
+            uint32_t *target = worker == 0 ? bins_.data() : worker_bins[worker - 1].data();
+            bin(points, start, stop, mvp, target);
+        }, "Bin points");
+
+        // reduce the private bins, zeroing them for the next frame, and find the new maximum
+        worker_max.assign(workers, max_hits_);
+        pool.parallel_for(0, static_cast<unsigned int>(bins_.size()), PointStore::PADDING, [&](unsigned int start, unsigned int stop, unsigned int worker){
+            uint32_t local_max = worker_max[worker];
+            for(std::vector<uint32_t> &other : worker_bins){
+                for(unsigned int i = start; i < stop; i++){
+                    bins_[i] += other[i];
+                    other[i] = 0;
+                }
+            }
+            for(unsigned int i = start; i < stop; i++) local_max = std::max(local_max, bins_[i]);
+            worker_max[worker] = local_max;
+        }, "Merge bins");
+        max_hits_ = *std::max_element(worker_max.begin(), worker_max.end());
+        samples_ += end - begin;
+    }
+
+    // Brightness in [0, 1] of a pixel with `hits` counts: log density relative to the densest
+    // pixel, gamma corrected. shaders/quad.fs implements the same curve.
+    // ------------------------------------------------------------------------
+    static float intensity(uint32_t hits, uint32_t max_hits, float gamma = 2.2f, float brightness = 1.0f)
+    {
+        if(hits == 0 || max_hits == 0) return 0.0f;
+        float density = std::log1p(static_cast<float>(hits)) / std::log1p(static_cast<float>(max_hits));
+        return std::min(1.0f, brightness * std::pow(density, 1.0f / gamma));
+    }
+
+private:
+    unsigned int width_ = 0, height_ = 0;
+    std::vector<uint32_t> bins_;
+    std::vector<std::vector<uint32_t>> worker_bins;
+    std::vector<uint32_t> worker_max;
+    uint32_t max_hits_ = 0;
+    uint64_t samples_ = 0;
+
+    void bin(const PointStore &points, unsigned int begin, unsigned int end, const glm::mat4 &mvp, uint32_t *target) const
+    {
+        const float *xs = points.x();
+        const float *ys = points.y();
+        const float *zs = points.z();
+        const float half_width = 0.5f * width_, half_height = 0.5f * height_;
+        for(unsigned int i = begin; i < end; i++){
+            float x = xs[i], y = ys[i], z = zs ? zs[i] : 0.0f;
+            // glm is column-major: mvp[column][row]
+            float clip_x = mvp[0][0] * x + mvp[1][0] * y + mvp[2][0] * z + mvp[3][0];
+            float clip_y = mvp[0][1] * x + mvp[1][1] * y + mvp[2][1] * z + mvp[3][1];
+            float clip_w = mvp[0][3] * x + mvp[1][3] * y + mvp[2][3] * z + mvp[3][3];
+            if(!(clip_w > 0.0f)) continue;
+            float px = (clip_x / clip_w + 1.0f) * half_width;
+            float py = (clip_y / clip_w + 1.0f) * half_height;
+            // also rejects NaN from points that escaped to infinity
+            if(!(px >= 0.0f && py >= 0.0f && px < width_ && py < height_)) continue;
+            target[static_cast<unsigned int>(py) * width_ + static_cast<unsigned int>(px)]++;
+        }
+    }
+};
+#endif
@@ -0,0 +1,86 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <cstring>
+#include <iostream>
+
+// OpenGL 4.3 core context without a window or display, for the command line tools. It uses
+// EGL's surfaceless platform when the driver offers it (Mesa does, including the llvmpipe
+// software rasterizer) and the default display otherwise. All rendering goes to FBOs/SSBOs.
+class HeadlessContext
+{
+public:
+    bool valid = false;
+
+    HeadlessContext()
+    {
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if(getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)){
+            std::cout << "ERROR::EGL::NO_DISPLAY" << std::endl;
+            return;
+        }
+        if(!eglBindAPI(EGL_OPENGL_API)){
+            std::cout << "ERROR::EGL::OPENGL_API_UNAVAILABLE" << std::endl;
+            return;
+        }
+
+        const EGLint config_attributes[] = {
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_NONE
+        };
+        // nothing is ever drawn to an EGL surface, so a config is optional where
+        // EGL_KHR_no_config_context is supported (the surfaceless platform often has none)
+        EGLConfig config = EGL_NO_CONFIG_KHR;
+        EGLint config_count = 0;
+        const char *extensions = eglQueryString(display, EGL_EXTENSIONS);
+        bool no_config = extensions && std::strstr(extensions, "EGL_KHR_no_config_context");
+        if((!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0) && !no_config){
+            std::cout << "ERROR::EGL::NO_CONFIG" << std::endl;
+            return;
+        }
+        if(config_count == 0) config = EGL_NO_CONFIG_KHR;
+
+        const EGLint context_attributes[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attributes);
+        if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)){
+            std::cout << "ERROR::EGL::CONTEXT_CREATION_FAILED (OpenGL 4.3 core, surfaceless)" << std::endl;
+            return;
+        }
+        if(!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)){
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return;
+        }
+        valid = true;
+    }
+    ~HeadlessContext()
+    {
+        if(display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+    // GL_RENDERER, e.g. "llvmpipe (LLVM 15.0.6, 256 bits)"
+    const char *renderer() const
+    {
+        return valid ? (const char*)glGetString(GL_RENDERER) : "none";
+    }
+
+private:
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+#endif
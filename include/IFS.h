@@ -0,0 +1,287 @@
+#ifndef IFS_H
+#define IFS_H
+
+#include <SimdKernel.h>
+#include <AliasTable.h>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// One affine map of an iterated function system together with its selection weight.
+// The matrix keeps the map row by row in glm's columns - the layout the compute shader
+// receives with transpose = GL_TRUE - so transform[r][c] is row r, column c:
+// x' = transform[0][0] x + transform[0][1] y + transform[0][2] z + transform[0][3]
+struct AffineMap
+{
+    glm::mat4 transform;
+    float weight;
+};
+
+inline glm::mat4 affine_rows(glm::vec4 x, glm::vec4 y, glm::vec4 z = glm::vec4(0.0f, 0.0f, 1.0f, 0.0f))
+{
+    return glm::mat4(x, y, z, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+}
+
+// An iterated function system described purely as data: a table of 2D or 3D affine maps with
+// per-map weights. All backends run the same fractal from it, the CPU ones through the
+// flattened MapTable, the compute shader through transforms() and alias().
+class IFS
+{
+public:
+    std::string name;
+    unsigned int dimensions = 2;
+    std::vector<AffineMap> maps;
+
+    IFS() {}
+    IFS(std::string name, unsigned int dimensions, std::vector<AffineMap> maps) : name(name), dimensions(dimensions), maps(maps)
+    {
+        rebuild();
+    }
+
+    // refreshes the tables derived from maps, call after every change to maps or weights
+    // ------------------------------------------------------------------------
+    void rebuild()
+    {
+        if(maps.size() > MapTable::MAX_MAPS){
+            std::cout << "Warning: IFS '" << name << "' has " << maps.size() << " maps, only the first " << MapTable::MAX_MAPS << " are used." << std::endl;
+            maps.resize(MapTable::MAX_MAPS);
+        }
+        unsigned int count = static_cast<unsigned int>(maps.size());
+
+        std::vector<float> weights(count);
+        for(unsigned int k = 0; k < count; k++) weights[k] = maps[k].weight;
+        alias_table.build(weights);
+
+        flat = MapTable();
+        flat.count = count;
+        flat.dimensions = dimensions;
+        matrices.resize(count);
+        for(unsigned int k = 0; k < count; k++){
+            const glm::mat4 &m = maps[k].transform;
+            matrices[k] = m;
+            for(unsigned int row = 0; row < 3; row++){
+                for(unsigned int column = 0; column < 4; column++){
+                    flat.coefficients[row * 4 + column][k] = m[row][column];
+                }
+            }
+            flat.alias_probability[k] = static_cast<int32_t>(alias_table.probability[k] * 16777216.0f + 0.5f);
+            flat.alias_index[k] = alias_table.alias[k];
+        }
+    }
+
+    const MapTable &table() const { return flat; }
+    unsigned int size() const { return flat.count; }
+    // row-major matrices for glUniformMatrix4fv(..., GL_TRUE, ...)
+    const glm::mat4 *transforms() const { return matrices.data(); }
+    // map selection table, rebuilt together with the maps
+    const AliasTable &alias() const { return alias_table; }
+
+    // box (min x, min y, max x, max y) around the x/y projection of the attractor, widened
+    // by margin; [-1, 1]^2 if the maps diverge
+    // ------------------------------------------------------------------------
+    glm::vec4 bounds(float margin = 0.05f, unsigned int samples = 1 << 14) const
+    {
+        const glm::vec4 fallback(-1.0f, -1.0f, 1.0f, 1.0f);
+        if(size() == 0) return fallback;
+        // a short chaos game with a fixed seed, the same maps always give the same box
+        std::mt19937 generator(1);
+        std::uniform_int_distribution<unsigned int> pick(0, size() - 1);
+        glm::vec4 point(0.0f, 0.0f, 0.0f, 1.0f);
+        glm::vec2 low(std::numeric_limits<float>::max()), high(std::numeric_limits<float>::lowest());
+        // the first steps only bring the point onto the attractor
+        const unsigned int warmup = 64;
+        for(unsigned int i = 0; i < warmup + samples; i++){
+            unsigned int index = pick(generator);
+            // the attractor only depends on which maps can be picked, not on how often
+            if(maps[index].weight <= 0.0f) continue;
+            point = apply(matrices[index], point);
+            if(i < warmup) continue;
+            if(!std::isfinite(point.x) || !std::isfinite(point.y)) return fallback;
+            low = glm::min(low, glm::vec2(point));
+            high = glm::max(high, glm::vec2(point));
+        }
+        if(low.x > high.x) return fallback;
+
+        // The sampled box misses extremes only long runs of one map reach (the fern's tip), so
+        // it is grown until every map sends it back into itself, then it holds the whole
+        // attractor. An affine map sends the box into the hull of its corners' images. Maps
+        // that stretch some box direction never settle and keep the sampled box with a margin
+        // of its full size, which still leaves 16-bit coordinates more than 20000 steps across
+        // the sampled part.
+        const glm::vec2 sampled_low = low, sampled_high = high;
+        bool settled = false;
+        for(unsigned int step = 0; step < 1024 && !settled; step++){
+            glm::vec2 grown_low = low, grown_high = high;
+            for(unsigned int k = 0; k < size(); k++){
+                if(maps[k].weight <= 0.0f) continue;
+                for(unsigned int corner = 0; corner < 4; corner++){
+                    glm::vec4 image = apply(matrices[k], glm::vec4(corner & 1 ? high.x : low.x, corner & 2 ? high.y : low.y, 0.0f, 1.0f));
+                    grown_low = glm::min(grown_low, glm::vec2(image));
+                    grown_high = glm::max(grown_high, glm::vec2(image));
+                }
+            }
+            glm::vec2 extent = glm::max(high - low, glm::vec2(1e-3f));
+            glm::vec2 growth = glm::max(low - grown_low, grown_high - high) / extent;
+            // a box that keeps growing by a fixed fraction belongs to maps it cannot contain
+            glm::vec2 blowup = (grown_high - grown_low) / glm::max(sampled_high - sampled_low, glm::vec2(1e-3f));
+            if(!(growth.x < 1.0f && growth.y < 1.0f && blowup.x < 100.0f && blowup.y < 100.0f)) break;
+            low = grown_low;
+            high = grown_high;
+            settled = growth.x < 1e-4f && growth.y < 1e-4f;
+        }
+        if(!settled){
+            low = sampled_low;
+            high = sampled_high;
+            margin = std::max(margin, 1.0f);
+        }
+        // a degenerate (line or point) attractor still gets a usable box
+        glm::vec2 extent = glm::max(high - low, glm::vec2(1e-3f));
+        return glm::vec4(low - margin * extent, high + margin * extent);
+    }
+
+    // presets
+    // ------------------------------------------------------------------------
+    static IFS sierpinski()
+    {
+        return IFS("Sierpinski", 2, {
+            { affine_rows(glm::vec4(0.5f, 0.0f, 0.0f,  0.0f),  glm::vec4(0.0f, 0.5f, 0.0f,  0.36f)), 1.0f },
+            { affine_rows(glm::vec4(0.5f, 0.0f, 0.0f, -0.5f),  glm::vec4(0.0f, 0.5f, 0.0f, -0.5f)),  1.0f },
+            { affine_rows(glm::vec4(0.5f, 0.0f, 0.0f,  0.5f),  glm::vec4(0.0f, 0.5f, 0.0f, -0.5f)),  1.0f },
+        });
+    }
+    // Barnsley's fern with its 1/85/7/7 weights: stem, successive leaflets, left and right leaflet
+    static IFS barnsley()
+    {
+        return IFS("Barnsley fern", 2, {
+            { affine_rows(glm::vec4( 0.00f,  0.00f, 0.0f, 0.0f), glm::vec4( 0.00f, 0.16f, 0.0f, 0.00f)), 0.01f },
+            { affine_rows(glm::vec4( 0.85f,  0.04f, 0.0f, 0.0f), glm::vec4(-0.04f, 0.85f, 0.0f, 1.60f)), 0.85f },
+            { affine_rows(glm::vec4( 0.20f, -0.26f, 0.0f, 0.0f), glm::vec4( 0.23f, 0.22f, 0.0f, 1.60f)), 0.07f },
+            { affine_rows(glm::vec4(-0.15f,  0.28f, 0.0f, 0.0f), glm::vec4( 0.26f, 0.24f, 0.0f, 0.44f)), 0.07f },
+        });
+    }
+    static IFS sierpinski_tetrahedron()
+    {
+        const glm::vec3 corners[4] = { glm::vec3(0.0f, 0.6f, 0.0f), glm::vec3(-0.5f, -0.3f, 0.3f), glm::vec3(0.5f, -0.3f, 0.3f), glm::vec3(0.0f, -0.3f, -0.5f) };
+        std::vector<AffineMap> maps;
+        for(const glm::vec3 &corner : corners){
+            maps.push_back({ affine_rows(glm::vec4(0.5f, 0.0f, 0.0f, corner.x * 0.5f),
+                                         glm::vec4(0.0f, 0.5f, 0.0f, corner.y * 0.5f),
+                                         glm::vec4(0.0f, 0.0f, 0.5f, corner.z * 0.5f)), 1.0f });
+        }
+        return IFS("Sierpinski tetrahedron", 3, maps);
+    }
+    // axis-aligned scale + translate maps, what compute_random used to iterate
+    static IFS random_scaling(std::mt19937 &generator, unsigned int count = 3)
+    {
+        std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+        std::vector<AffineMap> maps;
+        for(unsigned int k = 0; k < count; k++){
+            glm::vec4 x(dis(generator), 0.0f, 0.0f, dis(generator));
+            glm::vec4 y(0.0f, dis(generator), 0.0f, dis(generator));
+            maps.push_back({ affine_rows(x, y), 1.0f });
+        }
+        return IFS("Random scaling", 2, maps);
+    }
+    // general random 2D maps, what compute_random_but_cooler used to iterate
+    static IFS random(std::mt19937 &generator, unsigned int count = 3)
+    {
+        std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+        std::vector<AffineMap> maps;
+        for(unsigned int k = 0; k < count; k++){
+            glm::vec4 x(dis(generator), dis(generator), 0.0f, dis(generator));
+            glm::vec4 y(dis(generator), dis(generator), 0.0f, dis(generator));
+            maps.push_back({ affine_rows(x, y), 1.0f });
+        }
+        return IFS("Random", 2, maps);
+    }
+
+    // Reads an IFS from a text file, one map per line, '#' starts a comment:
+    //   2D: weight xx xy xt yx yy yt
+    //   3D: weight xx xy xz xt yx yy yz yt zx zy zz zt
+    // All lines have to use the same dimension. Returns false (and leaves fractal alone) on error.
+    // ------------------------------------------------------------------------
+    static bool load(const std::string &path, IFS &fractal)
+    {
+        std::ifstream file(path);
+        if(!file){
+            std::cout << "ERROR::IFS::FILE_NOT_SUCCESSFULLY_READ: " << path << std::endl;
+            return false;
+        }
+        IFS loaded;
+        loaded.name = path;
+        loaded.dimensions = 0;
+        std::string line;
+        unsigned int line_number = 0;
+        while(std::getline(file, line)){
+            line_number++;
+            line = line.substr(0, line.find('#'));
+            std::istringstream stream(line);
+            std::vector<float> values;
+            float value;
+            while(stream >> value) values.push_back(value);
+            if(values.empty() && stream.eof()) continue;
+
+            unsigned int dimensions = values.size() == 7 ? 2 : values.size() == 13 ? 3 : 0;
+            if(!stream.eof() || dimensions == 0 || (loaded.dimensions != 0 && dimensions != loaded.dimensions)){
+                std::cout << "ERROR::IFS::PARSE " << path << ":" << line_number << ": expected 7 (2D) or 13 (3D) numbers" << std::endl;
+                return false;
+            }
+            loaded.dimensions = dimensions;
+            glm::vec4 x, y, z(0.0f, 0.0f, 1.0f, 0.0f);
+            if(dimensions == 2){
+                x = glm::vec4(values[1], values[2], 0.0f, values[3]);
+                y = glm::vec4(values[4], values[5], 0.0f, values[6]);
+            } else {
+                x = glm::vec4(values[1], values[2], values[3], values[4]);
+                y = glm::vec4(values[5], values[6], values[7], values[8]);
+                z = glm::vec4(values[9], values[10], values[11], values[12]);
+            }
+            loaded.maps.push_back({ affine_rows(x, y, z), values[0] });
+        }
+        if(loaded.maps.empty()){
+            std::cout << "ERROR::IFS::NO_MAPS in " << path << std::endl;
+            return false;
+        }
+        loaded.rebuild();
+        fractal = loaded;
+        return true;
+    }
+
+    // preset by name as used on the command line: sierpinski, barnsley, tetrahedron, random
+    static bool preset(const std::string &name, IFS &fractal, std::mt19937 &generator)
+    {
+        if(name == "sierpinski") fractal = sierpinski();
+        else if(name == "barnsley") fractal = barnsley();
+        else if(name == "tetrahedron") fractal = sierpinski_tetrahedron();
+        else if(name == "random-scaling") fractal = random_scaling(generator);
+        else if(name == "random") fractal = random(generator);
+        else return false;
+        return true;
+    }
+
+private:
+    MapTable flat;
+
+    // one map applied to a homogeneous point, transform rows as in AffineMap
+    static glm::vec4 apply(const glm::mat4 &m, const glm::vec4 &point)
+    {
+        return glm::vec4(glm::dot(m[0], point), glm::dot(m[1], point), glm::dot(m[2], point), 1.0f);
+    }
+    std::vector<glm::mat4> matrices;
+    AliasTable alias_table;
+};
+#endif
@@ -0,0 +1,142 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Hardware performance counters of the calling thread through perf_event_open(2): cycles,
+// instructions, last level cache misses, branches and branch misses, opened as one group so
+// they count over the same intervals. Only user space is counted, which perf_event_paranoid
+// 2 (the usual default) allows without privileges. Counters the CPU or a virtual machine
+// does not offer stay invalid; if the cycle counter itself is missing nothing is available.
+// When the kernel multiplexes the group the values are scaled to the full enabled time.
+//
+// The counters follow the thread that created them, but start(), stop() and read() may be
+// called from any thread, so a pool's workers can each open their own set and the caller
+// drives all of them around a job:
+//
+//   PerfCounters counters;
+//   counters.start();
+//   ...
+//   counters.stop();
+//   PerfCounters::Values values = counters.read();
+//
+// Outside Linux available() is always false.
+class PerfCounters
+{
+public:
+    enum Counter
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        LLC_MISSES,
+        BRANCHES,
+        BRANCH_MISSES,
+        COUNT
+    };
+    static constexpr const char *NAMES[COUNT] = { "cycles", "instructions", "llc_misses", "branches", "branch_misses" };
+
+    struct Values
+    {
+        double value[COUNT] = {};
+        bool valid[COUNT] = {};
+
+        // sums counters of several threads or runs, a counter stays valid only if it is in both
+        Values& operator+=(const Values &other)
+        {
+            for(int k = 0; k < COUNT; k++){
+                value[k] += other.value[k];
+                valid[k] = valid[k] && other.valid[k];
+            }
+            return *this;
+        }
+    };
+
+    PerfCounters()
+    {
+#ifdef __linux__
+        const uint64_t configs[COUNT] = {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            // the generic cache miss event, the last level cache on current x86 and ARM cores
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+        for(int k = 0; k < COUNT; k++){
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.size = sizeof(attributes);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = configs[k];
+            attributes.disabled = k == CYCLES;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            descriptors[k] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, k == CYCLES ? -1 : descriptors[CYCLES], 0));
+            if(descriptors[CYCLES] < 0) return;
+        }
+#endif
+    }
+    ~PerfCounters()
+    {
+#ifdef __linux__
+        for(int fd : descriptors) if(fd >= 0) close(fd);
+#endif
+    }
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    bool available() const { return descriptors[CYCLES] >= 0; }
+
+    // zeroes the group and starts counting
+    void start()
+    {
+#ifdef __linux__
+        if(!available()) return;
+        ioctl(descriptors[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(descriptors[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        if(available()) ioctl(descriptors[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // counts between the last start() and stop()
+    // ------------------------------------------------------------------------
+    Values read() const
+    {
+        Values values;
+#ifdef __linux__
+        for(int k = 0; k < COUNT; k++){
+            if(descriptors[k] < 0) continue;
+            // value, time enabled, time running
+            uint64_t data[3] = {};
+            if(::read(descriptors[k], data, sizeof(data)) != sizeof(data)) continue;
+            if(data[2] == 0){
+                // never scheduled: zero if the group never ran, otherwise unknown
+                values.valid[k] = data[1] == 0;
+                continue;
+            }
+            values.value[k] = data[2] < data[1] ? (double)data[0] * data[1] / data[2] : (double)data[0];
+            values.valid[k] = true;
+        }
+#endif
+        return values;
+    }
+
+private:
+    int descriptors[COUNT] = { -1, -1, -1, -1, -1 };
+};
+#endif
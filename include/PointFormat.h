@@ -0,0 +1,159 @@
+#ifndef POINT_FORMAT_H
+#define POINT_FORMAT_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <PointStore.h>
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Layout of the points in the GPU buffers: the compute shader's SSBO, vertex attribute 0 and
+// the per-frame upload of CPU points. The CPU kernels always work on the floats of a
+// PointStore, only the copies handed to OpenGL are compacted.
+//
+//   VEC4     (x, y, z, 1) floats, 16 bytes per point, the only format that holds 3D points
+//   VEC2     (x, y) floats, 8 bytes, lossless for 2D fractals
+//   UNORM16  x and y as 16-bit fixed point inside a bounding box (IFS::bounds()), 4 bytes
+//
+// The vertex fetch expands VEC2 to (x, y, 0, 1) and UNORM16 to box-relative [0, 1]
+// coordinates that shader.vs maps back with its `bounds` uniform. shader.comp is compiled
+// for one format through defines().
+enum class PointFormat
+{
+    VEC4,
+    VEC2,
+    UNORM16
+};
+
+namespace point_format
+{
+    // in enum order, for combo boxes and the command line
+    inline const char *NAMES[] = { "vec4", "vec2", "unorm16" };
+
+    inline unsigned int bytes(PointFormat format)
+    {
+        switch(format){
+            case PointFormat::VEC2: return 2 * sizeof(float);
+            case PointFormat::UNORM16: return 2 * sizeof(uint16_t);
+            default: return 4 * sizeof(float);
+        }
+    }
+
+    inline const char *name(PointFormat format)
+    {
+        return NAMES[static_cast<int>(format)];
+    }
+
+    inline bool parse(std::string_view text, PointFormat &format)
+    {
+        for(int k = 0; k < 3; k++){
+            if(text == NAMES[k]){
+                format = static_cast<PointFormat>(k);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // the compact formats drop z, 3D fractals are always stored as vec4
+    inline PointFormat effective(PointFormat format, unsigned int dimensions)
+    {
+        return dimensions == 3 ? PointFormat::VEC4 : format;
+    }
+
+    // defines for the ComputeShader constructor
+    inline std::string defines(PointFormat format)
+    {
+        switch(format){
+            case PointFormat::VEC2: return "#define POINT_FORMAT_VEC2\n";
+            case PointFormat::UNORM16: return "#define POINT_FORMAT_UNORM16\n";
+            default: return "";
+        }
+    }
+
+    // box shader.vs maps the fetched x/y with, the identity for the float formats
+    inline glm::vec4 vertex_bounds(PointFormat format, const glm::vec4 &bounds)
+    {
+        return format == PointFormat::UNORM16 ? bounds : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    }
+
+    // points the format of vertex attribute 0 of vao, the buffer is bound with a stride of bytes()
+    // ------------------------------------------------------------------------
+    inline void attribute(GLuint vao, PointFormat format)
+    {
+        switch(format){
+            case PointFormat::VEC2: glVertexArrayAttribFormat(vao, 0, 2, GL_FLOAT, GL_FALSE, 0); break;
+            case PointFormat::UNORM16: glVertexArrayAttribFormat(vao, 0, 2, GL_UNSIGNED_SHORT, GL_TRUE, 0); break;
+            default: glVertexArrayAttribFormat(vao, 0, 4, GL_FLOAT, GL_FALSE, 0); break;
+        }
+    }
+
+    // GLSL's packUnorm2x16() for one coordinate, NaN ends up at the low edge
+    inline uint16_t encode_unorm16(float value, float low, float high)
+    {
+        float t = (value - low) / (high - low);
+        t = t > 0.0f ? (t < 1.0f ? t : 1.0f) : 0.0f;
+        return static_cast<uint16_t>(std::round(t * 65535.0f));
+    }
+
+    // writes size() points in format to destination, bounds only matter for UNORM16
+    // ------------------------------------------------------------------------
+    inline void pack(const PointStore &points, PointFormat format, void *destination, const glm::vec4 &bounds)
+    {
+        const float *xs = points.x(), *ys = points.y();
+        switch(format){
+            case PointFormat::VEC2: {
+                float *out = static_cast<float*>(destination);
+                for(unsigned int i = 0; i < points.size(); i++){
+                    out[2 * i] = xs[i];
+                    out[2 * i + 1] = ys[i];
+                }
+                break;
+            }
+            case PointFormat::UNORM16: {
+                uint16_t *out = static_cast<uint16_t*>(destination);
+                for(unsigned int i = 0; i < points.size(); i++){
+                    out[2 * i] = encode_unorm16(xs[i], bounds.x, bounds.z);
+                    out[2 * i + 1] = encode_unorm16(ys[i], bounds.y, bounds.w);
+                }
+                break;
+            }
+            default:
+                points.pack_vec4(static_cast<float*>(destination));
+                break;
+        }
+    }
+
+    // reads size() points in format back into the store, the inverse of pack()
+    // ------------------------------------------------------------------------
+    inline void unpack(PointStore &points, PointFormat format, const void *source, const glm::vec4 &bounds)
+    {
+        float *xs = points.x(), *ys = points.y();
+        switch(format){
+            case PointFormat::VEC2: {
+                const float *in = static_cast<const float*>(source);
+                for(unsigned int i = 0; i < points.size(); i++){
+                    xs[i] = in[2 * i];
+                    ys[i] = in[2 * i + 1];
+                }
+                break;
+            }
+            case PointFormat::UNORM16: {
+                const uint16_t *in = static_cast<const uint16_t*>(source);
+                for(unsigned int i = 0; i < points.size(); i++){
+                    xs[i] = bounds.x + (bounds.z - bounds.x) * (in[2 * i] / 65535.0f);
+                    ys[i] = bounds.y + (bounds.w - bounds.y) * (in[2 * i + 1] / 65535.0f);
+                }
+                break;
+            }
+            default:
+                points.unpack_vec4(static_cast<const float*>(source));
+                break;
+        }
+    }
+}
+#endif
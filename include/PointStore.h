@@ -0,0 +1,115 @@
+#ifndef POINT_STORE_H
+#define POINT_STORE_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Structure-of-arrays storage for the chaos-game points. The compute kernels only ever
+// touch x and y (and z for 3D fractals), so keeping them in separate, cache line aligned
+// arrays means every byte streamed through the cache is useful. The interleaved vec4
+// layout the VAO expects is only produced at upload time by pack_vec4().
+class PointStore
+{
+public:
+    // alignment of every coordinate array, large enough for a full AVX-512 register
+    static const std::size_t ALIGNMENT = 64;
+    // arrays are padded to a multiple of this many floats so vector loops never need a tail
+    static const unsigned int PADDING = ALIGNMENT / sizeof(float);
+
+    // constructor allocates uninitialized storage for count points, z only for 3 dimensions
+    // ------------------------------------------------------------------------
+    PointStore(unsigned int count, unsigned int dimensions = 2) : count(count), capacity((count + PADDING - 1) / PADDING * PADDING)
+    {
+        xs = allocate(capacity);
+        ys = allocate(capacity);
+        set_dimensions(dimensions);
+    }
+    ~PointStore()
+    {
+        release(xs);
+        release(ys);
+        if(zs) release(zs);
+    }
+    PointStore(const PointStore&) = delete;
+    PointStore& operator=(const PointStore&) = delete;
+
+    unsigned int size() const { return count; }
+    // number of allocated floats per array, always >= size() and a multiple of PADDING
+    unsigned int padded_size() const { return capacity; }
+
+    unsigned int dimensions() const { return zs ? 3 : 2; }
+
+    // allocates (zero-filled) or frees the z array
+    // ------------------------------------------------------------------------
+    void set_dimensions(unsigned int dimensions)
+    {
+        if(dimensions == 3 && !zs){
+            zs = allocate(capacity);
+            for(unsigned int i = 0; i < capacity; i++) zs[i] = 0.0f;
+        }
+        if(dimensions != 3 && zs){
+            release(zs);
+            zs = nullptr;
+        }
+    }
+
+    float *x() { return xs; }
+    float *y() { return ys; }
+    // nullptr for a 2D store
+    float *z() { return zs; }
+    const float *x() const { return xs; }
+    const float *y() const { return ys; }
+    const float *z() const { return zs; }
+
+    // fills the store with points uniformly distributed in [low, high)^d, padding included
+    // ------------------------------------------------------------------------
+    void generate(float low, float high)
+    {
+        for(unsigned int i = 0; i < capacity; i++){
+            xs[i] = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
+            ys[i] = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
+            if(zs) zs[i] = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
+        }
+    }
+
+    // writes the points as (x, y, z, 1) vec4s, the layout of the SSBO / vertex attribute 0
+    // ------------------------------------------------------------------------
+    void pack_vec4(float *vertices) const
+    {
+        for(unsigned int i = 0; i < count; i++){
+            vertices[4 * i]     = xs[i];
+            vertices[4 * i + 1] = ys[i];
+            vertices[4 * i + 2] = zs ? zs[i] : 0.0f;
+            vertices[4 * i + 3] = 1.0f;
+        }
+    }
+
+    // reads back (x, y, z, w) vec4s written by the compute shader, w is ignored
+    // ------------------------------------------------------------------------
+    void unpack_vec4(const float *vertices)
+    {
+        for(unsigned int i = 0; i < count; i++){
+            xs[i] = vertices[4 * i];
+            ys[i] = vertices[4 * i + 1];
+            if(zs) zs[i] = vertices[4 * i + 2];
+        }
+    }
+
+private:
+    unsigned int count;
+    unsigned int capacity;
+    float *xs;
+    float *ys;
+    float *zs = nullptr;
+
+    static float *allocate(unsigned int n)
+    {
+        return static_cast<float*>(::operator new[](sizeof(float) * n, std::align_val_t(ALIGNMENT)));
+    }
+    static void release(float *p)
+    {
+        ::operator delete[](p, std::align_val_t(ALIGNMENT));
+    }
+};
+#endif
@@ -0,0 +1,114 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// On-disk cache of linked shader programs (glGetProgramBinary / glProgramBinary). A program
+// is stored under a hash of its final sources (defines included) and of the driver's vendor,
+// renderer and version strings, so editing a shader, changing a define or updating the driver
+// all miss the cache. A binary the driver rejects anyway is simply recompiled from source.
+//
+//   std::string key = program_cache::key({ vertexCode, fragmentCode });
+//   if(!program_cache::load(ID, key)){
+//       compile, glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE), link
+//       program_cache::store(ID, key);
+//   }
+namespace program_cache
+{
+    inline const char *DIRECTORY = "shader_cache";
+    // first bytes of every cache file
+    inline const uint32_t MAGIC = 0x42504B41; // "AKPB"
+
+    // 64-bit FNV-1a of the sources and the driver strings, as 16 hex digits
+    // ------------------------------------------------------------------------
+    inline std::string key(std::initializer_list<std::string_view> sources)
+    {
+        uint64_t hash = 14695981039346656037ull;
+        auto add = [&hash](std::string_view text){
+            for(unsigned char c : text){
+                hash ^= c;
+                hash *= 1099511628211ull;
+            }
+            // separator, so moving text between parts changes the key
+            hash ^= 0xFF;
+            hash *= 1099511628211ull;
+        };
+        for(std::string_view source : sources) add(source);
+        for(GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION }){
+            const char *value = (const char*)glGetString(name);
+            add(value ? value : "");
+        }
+        char hex[17];
+        std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)hash);
+        return hex;
+    }
+
+    inline std::filesystem::path path(const std::string &key)
+    {
+        return std::filesystem::path(DIRECTORY) / (key + ".bin");
+    }
+
+    // links program from the cached binary; false if there is none or the driver refused it
+    // ------------------------------------------------------------------------
+    inline bool load(GLuint program, const std::string &key)
+    {
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if(formats == 0) return false;
+        std::ifstream file(path(key), std::ios::binary);
+        if(!file) return false;
+        uint32_t magic = 0;
+        GLenum format = 0;
+        file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+        file.read(reinterpret_cast<char*>(&format), sizeof(format));
+        if(!file || magic != MAGIC) return false;
+        std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if(binary.empty()) return false;
+
+        glProgramBinary(program, format, binary.data(), (GLsizei)binary.size());
+        GLint success = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        return success == GL_TRUE;
+    }
+
+    // writes a successfully linked program to the cache, failures only cost the next startup
+    // ------------------------------------------------------------------------
+    inline void store(GLuint program, const std::string &key)
+    {
+        GLint success = 0, length = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if(!success || length <= 0) return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        glGetProgramBinary(program, length, NULL, &format, binary.data());
+
+        std::error_code error;
+        std::filesystem::create_directories(DIRECTORY, error);
+        // write to a temporary name first so a crash never leaves a truncated binary behind
+        std::filesystem::path target = path(key), temporary = target;
+        temporary += ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            if(!file){
+                std::cout << "Warning: could not write the shader cache " << temporary.string() << std::endl;
+                return;
+            }
+            file.write(reinterpret_cast<const char*>(&MAGIC), sizeof(MAGIC));
+            file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+            file.write(binary.data(), binary.size());
+        }
+        std::filesystem::rename(temporary, target, error);
+    }
+}
+#endif
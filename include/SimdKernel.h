@@ -0,0 +1,330 @@
+#ifndef SIMD_KERNEL_H
+#define SIMD_KERNEL_H
+
+#include <PointStore.h>
+#include <CounterRng.h>
+
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNEL_X86 1
+#include <immintrin.h>
+#else
+#define SIMD_KERNEL_X86 0
+#endif
+
+// Vectorized chaos-game iteration. Each SIMD lane carries its own point and hashes its
+// index with the counter-based RNG, the map is selected per lane from the alias table and
+// its coefficients fetched with a permute (or a gather when the table does not fit in a
+// register), and the affine update is done with FMAs. The widest instruction set supported
+// by the CPU is picked at runtime, with a scalar fallback that draws the same random numbers.
+
+// Flattened form of an IFS that the kernels execute, built by IFS::rebuild().
+struct MapTable
+{
+    static const unsigned int MAX_MAPS = 16;
+
+    // x' = XX x + XY y + XZ z + XT, likewise for y' and z'
+    enum Coefficient { XX, XY, XZ, XT, YX, YY, YZ, YT, ZX, ZY, ZZ, ZT, COEFFICIENTS };
+
+    unsigned int count = 0;
+    unsigned int dimensions = 2;
+    alignas(64) float coefficients[COEFFICIENTS][MAX_MAPS] = {};
+    // alias table (see AliasTable.h) with the probabilities in 24 bit fixed point
+    alignas(64) int32_t alias_probability[MAX_MAPS] = {};
+    alignas(64) int32_t alias_index[MAX_MAPS] = {};
+};
+
+enum class SimdLevel
+{
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+inline const char *simd_level_name(SimdLevel level)
+{
+    switch(level){
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::AVX2:   return "AVX2";
+        default:                return "Scalar";
+    }
+}
+
+// queries CPUID once and returns the widest usable instruction set
+inline SimdLevel simd_level()
+{
+    static const SimdLevel level = []{
+#if SIMD_KERNEL_X86
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx512f")) return SimdLevel::AVX512;
+        if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SimdLevel::AVX2;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+namespace simd_detail
+{
+    // one alias table lookup: the top 24 bits of r scaled by count give the column in the
+    // integer part and the coin toss against alias_probability in the fraction
+    inline unsigned int select_map(const MapTable &table, uint32_t r)
+    {
+        int32_t u = static_cast<int32_t>((r >> 8) * table.count);
+        int32_t column = u >> 24;
+        return (u & 0xFFFFFF) < table.alias_probability[column] ? column : table.alias_index[column];
+    }
+
+    template<bool Is3D>
+    inline void iterate_scalar(const MapTable &table, float *xs, float *ys, float *zs, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed)
+    {
+        const auto &m = table.coefficients;
+        for(unsigned int i = 0; i < iterations; i++){
+            uint32_t key = rng::stream_key(seed, i);
+            for(unsigned int j = begin; j < end; j++){
+                unsigned int k = select_map(table, rng::sample(key, j));
+                float V_x = xs[j];
+                float V_y = ys[j];
+                if constexpr (Is3D){
+                    float V_z = zs[j];
+                    xs[j] = m[MapTable::XX][k] * V_x + m[MapTable::XY][k] * V_y + m[MapTable::XZ][k] * V_z + m[MapTable::XT][k];
+                    ys[j] = m[MapTable::YX][k] * V_x + m[MapTable::YY][k] * V_y + m[MapTable::YZ][k] * V_z + m[MapTable::YT][k];
+                    zs[j] = m[MapTable::ZX][k] * V_x + m[MapTable::ZY][k] * V_y + m[MapTable::ZZ][k] * V_z + m[MapTable::ZT][k];
+                } else {
+                    xs[j] = m[MapTable::XX][k] * V_x + m[MapTable::XY][k] * V_y + m[MapTable::XT][k];
+                    ys[j] = m[MapTable::YX][k] * V_x + m[MapTable::YY][k] * V_y + m[MapTable::YT][k];
+                }
+            }
+        }
+    }
+
+#if SIMD_KERNEL_X86
+    // rng::hash on 8 lanes
+    __attribute__((target("avx2,fma")))
+    inline __m256i hash_avx2(__m256i v)
+    {
+        __m256i state = _mm256_add_epi32(_mm256_mullo_epi32(v, _mm256_set1_epi32(rng::PCG_MULTIPLIER)), _mm256_set1_epi32(rng::PCG_INCREMENT));
+        __m256i shift = _mm256_add_epi32(_mm256_srli_epi32(state, 28), _mm256_set1_epi32(4));
+        __m256i word = _mm256_mullo_epi32(_mm256_xor_si256(_mm256_srlv_epi32(state, shift), state), _mm256_set1_epi32(rng::PCG_OUTPUT));
+        return _mm256_xor_si256(_mm256_srli_epi32(word, 22), word);
+    }
+
+    // GCC 12 implements the plain AVX-512 shifts and permutes as masked builtins with an
+    // undefined passthrough, which -Wmaybe-uninitialized reports at every use; the zero-masking
+    // forms with all 16 lanes set compile to the same instructions without it
+    const __mmask16 ALL_LANES = 0xFFFF;
+
+    __attribute__((target("avx512f")))
+    inline __m512i srli_avx512(__m512i v, unsigned int count)
+    {
+        return _mm512_maskz_srli_epi32(ALL_LANES, v, count);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512i srlv_avx512(__m512i v, __m512i count)
+    {
+        return _mm512_maskz_srlv_epi32(ALL_LANES, v, count);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512i permute_avx512(__m512i table, __m512i index)
+    {
+        return _mm512_maskz_permutexvar_epi32(ALL_LANES, index, table);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __m512 permute_avx512(__m512 table, __m512i index)
+    {
+        return _mm512_maskz_permutexvar_ps(ALL_LANES, index, table);
+    }
+
+    // rng::hash on 16 lanes
+    __attribute__((target("avx512f")))
+    inline __m512i hash_avx512(__m512i v)
+    {
+        __m512i state = _mm512_add_epi32(_mm512_mullo_epi32(v, _mm512_set1_epi32(rng::PCG_MULTIPLIER)), _mm512_set1_epi32(rng::PCG_INCREMENT));
+        __m512i shift = _mm512_add_epi32(srli_avx512(state, 28), _mm512_set1_epi32(4));
+        __m512i word = _mm512_mullo_epi32(_mm512_xor_si512(srlv_avx512(state, shift), state), _mm512_set1_epi32(rng::PCG_OUTPUT));
+        return _mm512_xor_si512(srli_avx512(word, 22), word);
+    }
+
+    // select_map on 8 lanes, probability/alias hold the first 8 table entries
+    __attribute__((target("avx2,fma")))
+    inline __m256i select_avx2(const MapTable &table, __m256i probability, __m256i alias, __m256i r, bool fits)
+    {
+        __m256i u = _mm256_mullo_epi32(_mm256_srli_epi32(r, 8), _mm256_set1_epi32(table.count));
+        __m256i column = _mm256_srli_epi32(u, 24);
+        __m256i fraction = _mm256_and_si256(u, _mm256_set1_epi32(0xFFFFFF));
+        if(fits){
+            probability = _mm256_permutevar8x32_epi32(probability, column);
+            alias = _mm256_permutevar8x32_epi32(alias, column);
+        } else {
+            probability = _mm256_i32gather_epi32(table.alias_probability, column, 4);
+            alias = _mm256_i32gather_epi32(table.alias_index, column, 4);
+        }
+        return _mm256_blendv_epi8(alias, column, _mm256_cmpgt_epi32(probability, fraction));
+    }
+
+    // select_map on 16 lanes
+    __attribute__((target("avx512f")))
+    inline __m512i select_avx512(const MapTable &table, __m512i probability, __m512i alias, __m512i r)
+    {
+        __m512i u = _mm512_mullo_epi32(srli_avx512(r, 8), _mm512_set1_epi32(table.count));
+        __m512i column = srli_avx512(u, 24);
+        __m512i fraction = _mm512_and_si512(u, _mm512_set1_epi32(0xFFFFFF));
+        __mmask16 keep = _mm512_cmpgt_epi32_mask(permute_avx512(probability, column), fraction);
+        return _mm512_mask_blend_epi32(keep, permute_avx512(alias, column), column);
+    }
+
+    __attribute__((target("avx2,fma")))
+    inline __m256 lookup_avx2(const float *coefficients, __m256 in_register, __m256i index, bool fits)
+    {
+        return fits ? _mm256_permutevar8x32_ps(in_register, index) : _mm256_i32gather_ps(coefficients, index, 4);
+    }
+
+    template<bool Is3D>
+    __attribute__((target("avx2,fma")))
+    inline void iterate_avx2(const MapTable &table, float *xs, float *ys, float *zs, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed)
+    {
+        const bool fits = table.count <= 8;
+        const auto &m = table.coefficients;
+        __m256 t[MapTable::COEFFICIENTS];
+        for(unsigned int c = 0; c < MapTable::COEFFICIENTS; c++) t[c] = _mm256_load_ps(m[c]);
+        const __m256i probability = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.alias_probability));
+        const __m256i alias = _mm256_load_si256(reinterpret_cast<const __m256i*>(table.alias_index));
+
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+        for(unsigned int i = 0; i < iterations; i++){
+            const __m256i key = _mm256_set1_epi32(rng::stream_key(seed, i));
+            for(unsigned int j = begin; j < end; j += 8){
+                __m256 x = _mm256_load_ps(xs + j);
+                __m256 y = _mm256_load_ps(ys + j);
+
+                __m256i index = _mm256_add_epi32(_mm256_set1_epi32(j), lanes);
+                __m256i k = select_avx2(table, probability, alias, hash_avx2(_mm256_xor_si256(index, key)), fits);
+
+                __m256 nx = _mm256_fmadd_ps(lookup_avx2(m[MapTable::XX], t[MapTable::XX], k, fits), x,
+                            _mm256_fmadd_ps(lookup_avx2(m[MapTable::XY], t[MapTable::XY], k, fits), y,
+                                            lookup_avx2(m[MapTable::XT], t[MapTable::XT], k, fits)));
+                __m256 ny = _mm256_fmadd_ps(lookup_avx2(m[MapTable::YX], t[MapTable::YX], k, fits), x,
+                            _mm256_fmadd_ps(lookup_avx2(m[MapTable::YY], t[MapTable::YY], k, fits), y,
+                                            lookup_avx2(m[MapTable::YT], t[MapTable::YT], k, fits)));
+                if constexpr (Is3D){
+                    __m256 z = _mm256_load_ps(zs + j);
+                    nx = _mm256_fmadd_ps(lookup_avx2(m[MapTable::XZ], t[MapTable::XZ], k, fits), z, nx);
+                    ny = _mm256_fmadd_ps(lookup_avx2(m[MapTable::YZ], t[MapTable::YZ], k, fits), z, ny);
+                    __m256 nz = _mm256_fmadd_ps(lookup_avx2(m[MapTable::ZX], t[MapTable::ZX], k, fits), x,
+                                _mm256_fmadd_ps(lookup_avx2(m[MapTable::ZY], t[MapTable::ZY], k, fits), y,
+                                _mm256_fmadd_ps(lookup_avx2(m[MapTable::ZZ], t[MapTable::ZZ], k, fits), z,
+                                                lookup_avx2(m[MapTable::ZT], t[MapTable::ZT], k, fits))));
+                    _mm256_store_ps(zs + j, nz);
+                }
+                _mm256_store_ps(xs + j, nx);
+                _mm256_store_ps(ys + j, ny);
+            }
+        }
+    }
+
+    template<bool Is3D>
+    __attribute__((target("avx512f")))
+    inline void iterate_avx512(const MapTable &table, float *xs, float *ys, float *zs, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed)
+    {
+        // MAX_MAPS == 16, so the whole table always fits in one register per coefficient
+        const auto &m = table.coefficients;
+        __m512 t[MapTable::COEFFICIENTS];
+        for(unsigned int c = 0; c < MapTable::COEFFICIENTS; c++) t[c] = _mm512_load_ps(m[c]);
+        const __m512i probability = _mm512_load_si512(table.alias_probability);
+        const __m512i alias = _mm512_load_si512(table.alias_index);
+
+        const __m512i lanes = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+        for(unsigned int i = 0; i < iterations; i++){
+            const __m512i key = _mm512_set1_epi32(rng::stream_key(seed, i));
+            for(unsigned int j = begin; j < end; j += 16){
+                __m512 x = _mm512_load_ps(xs + j);
+                __m512 y = _mm512_load_ps(ys + j);
+
+                __m512i index = _mm512_add_epi32(_mm512_set1_epi32(j), lanes);
+                __m512i k = select_avx512(table, probability, alias, hash_avx512(_mm512_xor_si512(index, key)));
+
+                __m512 nx = _mm512_fmadd_ps(permute_avx512(t[MapTable::XX], k), x,
+                            _mm512_fmadd_ps(permute_avx512(t[MapTable::XY], k), y,
+                                            permute_avx512(t[MapTable::XT], k)));
+                __m512 ny = _mm512_fmadd_ps(permute_avx512(t[MapTable::YX], k), x,
+                            _mm512_fmadd_ps(permute_avx512(t[MapTable::YY], k), y,
+                                            permute_avx512(t[MapTable::YT], k)));
+                if constexpr (Is3D){
+                    __m512 z = _mm512_load_ps(zs + j);
+                    nx = _mm512_fmadd_ps(permute_avx512(t[MapTable::XZ], k), z, nx);
+                    ny = _mm512_fmadd_ps(permute_avx512(t[MapTable::YZ], k), z, ny);
+                    __m512 nz = _mm512_fmadd_ps(permute_avx512(t[MapTable::ZX], k), x,
+                                _mm512_fmadd_ps(permute_avx512(t[MapTable::ZY], k), y,
+                                _mm512_fmadd_ps(permute_avx512(t[MapTable::ZZ], k), z,
+                                                permute_avx512(t[MapTable::ZT], k))));
+                    _mm512_store_ps(zs + j, nz);
+                }
+                _mm512_store_ps(xs + j, nx);
+                _mm512_store_ps(ys + j, ny);
+            }
+        }
+    }
+#endif
+
+    template<bool Is3D>
+    inline void iterate(const MapTable &table, PointStore &points, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed, SimdLevel level)
+    {
+#if SIMD_KERNEL_X86
+        if(level == SimdLevel::AVX512){
+            iterate_avx512<Is3D>(table, points.x(), points.y(), points.z(), begin, end, iterations, seed);
+            return;
+        }
+        if(level == SimdLevel::AVX2){
+            iterate_avx2<Is3D>(table, points.x(), points.y(), points.z(), begin, end, iterations, seed);
+            return;
+        }
+#endif
+        iterate_scalar<Is3D>(table, points.x(), points.y(), points.z(), begin, end, iterations, seed);
+    }
+}
+
+// Runs `iterations` chaos-game steps over the points [begin, end). begin has to be a multiple
+// of PointStore::PADDING; end is rounded up to the next multiple, which stays inside the
+// padded arrays, so the vector loops never need a scalar tail. z is only iterated for 3D
+// tables on a store that has a z array.
+inline void iterate_simd(const MapTable &table, PointStore &points, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed, SimdLevel level = simd_level())
+{
+    if(table.count == 0) return;
+    end = (end + PointStore::PADDING - 1) / PointStore::PADDING * PointStore::PADDING;
+    if(end > points.padded_size()) end = points.padded_size();
+    if(table.dimensions == 3 && points.z())
+        simd_detail::iterate<true>(table, points, begin, end, iterations, seed, level);
+    else
+        simd_detail::iterate<false>(table, points, begin, end, iterations, seed, level);
+}
+// How the CPU backends schedule the work of a frame.
+struct IterationOptions
+{
+    // run all iterations on one block of points before moving on to the next, so the block
+    // stays in L1 and the arrays are streamed from memory once per frame instead of once
+    // per iteration; the counter-based RNG makes the result identical to the unfused order
+    bool fused = true;
+    // points per block, rounded up to PointStore::PADDING; 2048 2D points are 16 KB
+    unsigned int block_size = 2048;
+};
+
+// iterate_simd() over [begin, end) with the scheduling chosen in options
+inline void iterate_blocked(const MapTable &table, PointStore &points, unsigned int begin, unsigned int end, unsigned int iterations, uint32_t seed, const IterationOptions &options, SimdLevel level = simd_level())
+{
+    if(!options.fused){
+        iterate_simd(table, points, begin, end, iterations, seed, level);
+        return;
+    }
+    unsigned int block = (options.block_size + PointStore::PADDING - 1) / PointStore::PADDING * PointStore::PADDING;
+    if(block == 0) block = PointStore::PADDING;
+    for(unsigned int start = begin; start < end; start += block){
+        iterate_simd(table, points, start, end - start > block ? start + block : end, iterations, seed, level);
+    }
+}
+#endif
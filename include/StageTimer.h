@@ -0,0 +1,210 @@
+#ifndef STAGE_TIMER_H
+#define STAGE_TIMER_H
+
+#include <glad/glad.h>
+#include "imgui/imgui.h"
+
+#include <Trace.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cfloat>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// Per-frame timings of named stages of the render loop: CPU wall time and, for stages that
+// issue GL work, the GPU time between two GL_TIMESTAMP queries around the stage. Timestamps
+// rather than GL_TIME_ELAPSED because elapsed-time queries cannot nest and Mesa's llvmpipe
+// leaves compute dispatches out of them. Every stage owns two query pairs used on alternate
+// frames, and a result is only read back after the following frame has been submitted, when
+// it is normally available, so the timer never waits on the GPU. Results that are still not
+// ready are dropped instead.
+//
+//   {
+//       StageTimer::Scope scope(stage_timer, "Compute");
+//       ...
+//   }
+//
+// A disabled timer costs one branch per scope. Every scope is also a trace::Zone, so the
+// stages show up on the timeline while a trace is recording, whether the timer is on or not.
+class StageTimer
+{
+public:
+    // frames kept for the graphs and statistics
+    static constexpr unsigned int HISTORY = 256;
+
+    bool enabled = false;
+
+    class Scope
+    {
+    public:
+        Scope(StageTimer &timer, const char *name, bool gpu = true) : zone(name), timer(timer.enabled ? &timer : nullptr)
+        {
+            if(this->timer) stage = this->timer->begin(name, gpu);
+        }
+        ~Scope()
+        {
+            if(timer) timer->end(stage);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        trace::Zone zone;
+        StageTimer *timer;
+        unsigned int stage = 0;
+    };
+
+    // closes the previous frame: stores its CPU times and collects the GPU results of the
+    // frame before it; call once per frame before the first scope
+    // ------------------------------------------------------------------------
+    void new_frame()
+    {
+        if(!enabled) return;
+        unsigned int slot = frame % HISTORY;
+        // the next frame reuses the queries the one before this issued
+        unsigned int parity = (frame + 1) % 2;
+        for(Stage &stage : stages){
+            stage.cpu_ms[slot] = stage.frame_cpu_ms;
+            stage.frame_cpu_ms = 0.0f;
+            if(stage.pending[parity]){
+                GLuint *pair = stage.queries[parity];
+                // the end timestamp is the later command, once it is there so is the start
+                GLint available = 0;
+                glGetQueryObjectiv(pair[1], GL_QUERY_RESULT_AVAILABLE, &available);
+                if(available){
+                    GLuint64 start = 0, end = 0;
+                    glGetQueryObjectui64v(pair[0], GL_QUERY_RESULT, &start);
+                    glGetQueryObjectui64v(pair[1], GL_QUERY_RESULT, &end);
+                    stage.gpu_ms[stage.query_frame[parity] % HISTORY] = (end - start) / 1e6f;
+                }
+                stage.pending[parity] = false;
+            }
+        }
+        frame++;
+    }
+
+    // the ImGui panel: per-stage min/avg/p99 of CPU and GPU time plus rolling graphs
+    // ------------------------------------------------------------------------
+    void draw()
+    {
+        if(!enabled) return;
+        ImGui::Begin("Stage timings");
+        unsigned int count = std::min(frame, HISTORY);
+        if(ImGui::BeginTable("Stages", 7, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit)){
+            const char *headers[] = { "Stage", "CPU min", "avg", "p99", "GPU min", "avg", "p99" };
+            for(const char *header : headers) ImGui::TableSetupColumn(header);
+            ImGui::TableHeadersRow();
+            for(Stage &stage : stages){
+                Statistics cpu = statistics(stage.cpu_ms, count), gpu = statistics(stage.gpu_ms, count);
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn(); ImGui::TextUnformatted(stage.name);
+                const float values[] = { cpu.min, cpu.avg, cpu.p99, gpu.min, gpu.avg, gpu.p99 };
+                for(unsigned int v = 0; v < 6; v++){
+                    ImGui::TableNextColumn();
+                    if(v >= 3 && !stage.gpu) ImGui::TextUnformatted("-");
+                    else ImGui::Text("%.3f", values[v]);
+                }
+            }
+            ImGui::EndTable();
+        }
+        for(Stage &stage : stages){
+            char label[96];
+            // oldest sample first; offset wraps the ring buffer
+            int offset = static_cast<int>(frame % HISTORY);
+            std::snprintf(label, sizeof(label), "%s CPU ms", stage.name);
+            ImGui::PlotLines(label, stage.cpu_ms.data(), HISTORY, offset, NULL, 0.0f, FLT_MAX, ImVec2(0, 40));
+            if(stage.gpu){
+                std::snprintf(label, sizeof(label), "%s GPU ms", stage.name);
+                ImGui::PlotLines(label, stage.gpu_ms.data(), HISTORY, offset, NULL, 0.0f, FLT_MAX, ImVec2(0, 40));
+            }
+        }
+        ImGui::End();
+    }
+
+    // deletes the query objects, call while the context is still current
+    void release()
+    {
+        for(Stage &stage : stages){
+            if(stage.queries[0][0]) glDeleteQueries(4, &stage.queries[0][0]);
+        }
+        stages.clear();
+    }
+
+private:
+    struct Stage
+    {
+        const char *name;
+        std::array<float, HISTORY> cpu_ms{};
+        std::array<float, HISTORY> gpu_ms{};
+        // a stage can run several times per frame, its CPU time is summed
+        float frame_cpu_ms = 0.0f;
+        std::chrono::steady_clock::time_point start;
+        bool gpu = false;
+        bool timing_gpu = false;
+        // start/end timestamp pair per frame parity
+        GLuint queries[2][2] = { { 0, 0 }, { 0, 0 } };
+        bool pending[2] = { false, false };
+        unsigned int query_frame[2] = { 0, 0 };
+    };
+    struct Statistics
+    {
+        float min = 0.0f, avg = 0.0f, p99 = 0.0f;
+    };
+
+    std::vector<Stage> stages;
+    unsigned int frame = 0;
+    std::vector<float> sorted;
+
+    unsigned int begin(const char *name, bool gpu)
+    {
+        // stages are few and named by literals, a pointer compare finds them
+        unsigned int index = 0;
+        while(index < stages.size() && stages[index].name != name) index++;
+        if(index == stages.size()){
+            stages.push_back(Stage());
+            stages.back().name = name;
+        }
+        Stage &stage = stages[index];
+        unsigned int parity = frame % 2;
+        // a stage that already ran this frame only adds CPU time
+        stage.timing_gpu = gpu && !stage.pending[parity];
+        if(stage.timing_gpu){
+            if(!stage.queries[0][0]) glGenQueries(4, &stage.queries[0][0]);
+            stage.gpu = true;
+            glQueryCounter(stage.queries[parity][0], GL_TIMESTAMP);
+        }
+        stage.start = std::chrono::steady_clock::now();
+        return index;
+    }
+
+    void end(unsigned int index)
+    {
+        Stage &stage = stages[index];
+        stage.frame_cpu_ms += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - stage.start).count();
+        if(stage.timing_gpu){
+            unsigned int parity = frame % 2;
+            glQueryCounter(stage.queries[parity][1], GL_TIMESTAMP);
+            stage.pending[parity] = true;
+            stage.query_frame[parity] = frame;
+            stage.timing_gpu = false;
+        }
+    }
+
+    Statistics statistics(const std::array<float, HISTORY> &samples, unsigned int count)
+    {
+        Statistics result;
+        if(count == 0) return result;
+        sorted.assign(samples.begin(), samples.begin() + count);
+        std::sort(sorted.begin(), sorted.end());
+        result.min = sorted.front();
+        double sum = 0.0;
+        for(float sample : sorted) sum += sample;
+        result.avg = static_cast<float>(sum / sorted.size());
+        result.p99 = sorted[std::min<std::size_t>(sorted.size() - 1, sorted.size() * 99 / 100)];
+        return result;
+    }
+};
+#endif
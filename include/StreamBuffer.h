@@ -0,0 +1,134 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+
+// Ring of `segments` equally sized regions in one immutable buffer that stays mapped
+// (persistent + coherent) for its whole life. The CPU writes a frame's data straight into
+// GPU-visible memory and the draw reads it from there: no glBufferData reallocation and no
+// driver-side staging copy. A fence after the last use of a segment keeps the CPU from
+// overwriting data the GPU has not consumed yet; with three segments it rarely has to wait.
+//
+//   void *dst = stream.begin();   // waits for the segment, if at all
+//   ... write up to segment_size() bytes ...
+//   draw from stream.ID at stream.offset()
+//   stream.end();                 // fences the segment
+//
+// Segments are rounded up to GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, so any of them can
+// be bound with glBindBufferRange as well.
+class StreamBuffer
+{
+public:
+    unsigned int ID = 0;
+
+    StreamBuffer(std::size_t segment_size, unsigned int segments = 3) : segment_bytes(aligned(segment_size)), fences(segments, nullptr)
+    {
+        allocate();
+    }
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // unmaps and deletes the buffer, call while the context is still current
+    // ------------------------------------------------------------------------
+    void release()
+    {
+        for(GLsync &fence : fences){
+            if(fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if(mapped) glUnmapNamedBuffer(ID);
+        mapped = nullptr;
+        glDeleteBuffers(1, &ID);
+        ID = 0;
+    }
+
+    // blocks until the GPU is done with every segment
+    void wait()
+    {
+        for(GLsync &fence : fences){
+            if(!fence) continue;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+
+    // replaces the buffer with one of segment_size bytes per segment, once the GPU no longer
+    // reads the old one; must not be called between begin() and end()
+    // ------------------------------------------------------------------------
+    void resize(std::size_t segment_size)
+    {
+        if(aligned(segment_size) == segment_bytes && valid()) return;
+        wait();
+        release();
+        segment_bytes = aligned(segment_size);
+        current = 0;
+        allocate();
+    }
+
+    bool valid() const { return mapped != nullptr; }
+    std::size_t segment_size() const { return segment_bytes; }
+    // byte offset of the current segment in the buffer, for glVertexArrayVertexBuffer & co.
+    std::size_t offset() const { return current * segment_bytes; }
+    // time the last begin() spent waiting for the GPU
+    float stall_ms() const { return last_stall_ms; }
+
+    // advances to the next segment and returns its memory once the GPU is done with it
+    // ------------------------------------------------------------------------
+    void *begin()
+    {
+        current = (current + 1) % fences.size();
+        last_stall_ms = 0.0f;
+        GLsync &fence = fences[current];
+        if(fence){
+            auto start = std::chrono::steady_clock::now();
+            GLenum status = glClientWaitSync(fence, 0, 0);
+            // the first real wait flushes, so the fence is guaranteed to signal
+            while(status == GL_TIMEOUT_EXPIRED) status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+            if(status == GL_WAIT_FAILED) std::cout << "ERROR::STREAM_BUFFER::WAIT_FAILED" << std::endl;
+            last_stall_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        return mapped + offset();
+    }
+
+    // marks the current segment as in use by every command issued so far
+    void end()
+    {
+        fences[current] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+private:
+    // size rounded up to the storage buffer offset alignment, queried once
+    static std::size_t aligned(std::size_t size)
+    {
+        static const std::size_t alignment = []{
+            GLint value = 0;
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &value);
+            return value > 0 ? static_cast<std::size_t>(value) : std::size_t(1);
+        }();
+        return (size + alignment - 1) / alignment * alignment;
+    }
+
+    void allocate()
+    {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &ID);
+        glNamedBufferStorage(ID, segment_bytes * fences.size(), NULL, flags);
+        mapped = static_cast<char*>(glMapNamedBufferRange(ID, 0, segment_bytes * fences.size(), flags));
+        if(!mapped) std::cout << "ERROR::STREAM_BUFFER::MAP_FAILED" << std::endl;
+    }
+
+    std::size_t segment_bytes;
+    std::vector<GLsync> fences;
+    unsigned int current = 0;
+    char *mapped = nullptr;
+    float last_stall_ms = 0.0f;
+};
+#endif
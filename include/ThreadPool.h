@@ -0,0 +1,229 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <Trace.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Persistent pool of worker threads. The workers are created once and park on a condition
+// variable between jobs, so a parallel_for costs two wake-ups instead of a thread creation
+// and join per chunk. The calling thread takes part in the work as worker 0.
+//
+// With set_pinning(true) worker i runs on the i-th CPU the process may use (wrapping around),
+// which keeps each chunk's cache lines and NUMA pages where they were touched. Pinning is a
+// no-op outside Linux.
+//
+// Every chunk is a trace zone named after the job, on the track of the thread that ran it;
+// the workers' tracks are called "Worker 1", "Worker 2", ...
+class ThreadPool
+{
+public:
+    // chunk callback: [begin, end) of the range and the index of the worker running it
+    using Task = std::function<void(unsigned int begin, unsigned int end, unsigned int worker)>;
+
+    // threads == 0 sizes the pool from std::thread::hardware_concurrency()
+    // ------------------------------------------------------------------------
+    ThreadPool(unsigned int threads = 0)
+    {
+#ifdef __linux__
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+#endif
+        start(threads);
+    }
+    ~ThreadPool()
+    {
+        stop();
+        set_caller_affinity(false);
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // total number of threads working on a job, the caller included
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    static unsigned int default_size()
+    {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // joins the current workers and starts a new set, must not be called during a job
+    // ------------------------------------------------------------------------
+    void resize(unsigned int threads)
+    {
+        if(threads == 0) threads = default_size();
+        if(threads == size()) return;
+        stop();
+        start(threads);
+    }
+
+    bool pinned() const { return pinning; }
+
+    // pins the workers, and the thread calling this as worker 0, to one CPU each, or gives
+    // them back their previous CPU sets; restarts the workers, so it must not be called during a job
+    // ------------------------------------------------------------------------
+    void set_pinning(bool enabled)
+    {
+        if(enabled == pinning) return;
+        unsigned int threads = size();
+        stop();
+        pinning = enabled;
+        set_caller_affinity(enabled);
+        start(threads);
+    }
+
+    // Splits [begin, end) into one contiguous chunk per thread and blocks until all of them
+    // are done. Chunk boundaries are multiples of `grain` (counted from begin), the last chunk
+    // takes the remainder. `name` labels the chunks in traces and must be a literal.
+    // ------------------------------------------------------------------------
+    void parallel_for(unsigned int begin, unsigned int end, unsigned int grain, const Task &task, const char *name = "parallel_for")
+    {
+        if(end <= begin) return;
+        unsigned int threads = size();
+        unsigned int blocks = (end - begin + grain - 1) / grain;
+        unsigned int per_thread = (blocks + threads - 1) / threads * grain;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &task;
+            job_name = name;
+            job_begin = begin;
+            job_end = end;
+            job_chunk = per_thread;
+            pending = threads - 1;
+            generation++;
+        }
+        wake.notify_all();
+
+        run_chunk(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]{ return pending == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const Task *job = nullptr;
+    const char *job_name = nullptr;
+    unsigned int job_begin = 0;
+    unsigned int job_end = 0;
+    unsigned int job_chunk = 0;
+    unsigned int pending = 0;
+    unsigned long long generation = 0;
+    bool quit = false;
+    bool pinning = false;
+#ifdef __linux__
+    // CPUs the process was allowed at construction, and the caller's mask before pinning
+    cpu_set_t allowed;
+    cpu_set_t caller_mask;
+    bool caller_pinned = false;
+#endif
+
+    void start(unsigned int threads)
+    {
+        if(threads == 0) threads = default_size();
+        quit = false;
+        workers.reserve(threads - 1);
+        for(unsigned int i = 1; i < threads; i++){
+            workers.emplace_back(&ThreadPool::worker_loop, this, i, generation);
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for(auto &worker : workers){
+            if(worker.joinable()) worker.join();
+        }
+        workers.clear();
+    }
+
+    void run_chunk(unsigned int worker)
+    {
+        unsigned long long start = job_begin + (unsigned long long)job_chunk * worker;
+        if(start >= job_end) return;
+        trace::Zone zone(job_name);
+        unsigned int end = static_cast<unsigned int>(std::min<unsigned long long>(start + job_chunk, job_end));
+        (*job)(static_cast<unsigned int>(start), end, worker);
+    }
+
+#ifdef __linux__
+    // the worker-th allowed CPU, counting around the set
+    cpu_set_t cpu_for(unsigned int worker) const
+    {
+        unsigned int count = CPU_COUNT(&allowed), k = worker % std::max(1u, count);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for(int cpu = 0; cpu < CPU_SETSIZE; cpu++){
+            if(!CPU_ISSET(cpu, &allowed)) continue;
+            if(k-- == 0){
+                CPU_SET(cpu, &set);
+                break;
+            }
+        }
+        return set;
+    }
+#endif
+
+    void set_caller_affinity(bool pin)
+    {
+#ifdef __linux__
+        if(pin && !caller_pinned){
+            pthread_getaffinity_np(pthread_self(), sizeof(caller_mask), &caller_mask);
+            cpu_set_t set = cpu_for(0);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            caller_pinned = true;
+        } else if(!pin && caller_pinned){
+            pthread_setaffinity_np(pthread_self(), sizeof(caller_mask), &caller_mask);
+            caller_pinned = false;
+        }
+#else
+        (void)pin;
+#endif
+    }
+
+    // seen starts at the generation the worker was created in, so it only picks up new jobs
+    void worker_loop(unsigned int worker, unsigned long long seen)
+    {
+        trace::name_thread("Worker " + std::to_string(worker));
+#ifdef __linux__
+        if(pinning){
+            cpu_set_t set = cpu_for(worker);
+            pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        }
+#endif
+        for(;;){
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]{ return quit || generation != seen; });
+                if(quit) return;
+                seen = generation;
+            }
+            run_chunk(worker);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            done.notify_one();
+        }
+    }
+};
+#endif
@@ -0,0 +1,257 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Timeline of instrumentation zones, written as a Chrome trace (chrome://tracing, Perfetto's
+// ui.perfetto.dev) with one track per thread. Every thread records into its own ring of the
+// last RING_SIZE zones; only the owner writes to a ring, so recording takes no lock, and
+// write() copies the rings while the threads keep going, dropping whatever they overwrite
+// during the copy.
+//
+// A thread only gets a ring with the first zone it records, threads that never record cost
+// nothing. The ring of an exited thread stays in the trace until the next start() and is
+// then reused by the next thread that records.
+//
+//   trace::name_thread("Main");
+//   trace::start();
+//   {
+//       trace::Zone zone("Compute");
+//       ...
+//   }
+//   trace::write("trace.json");
+//
+// While not recording a zone costs one relaxed atomic load. Zone names must outlive the
+// recording, string literals in practice.
+namespace trace
+{
+    // zones kept per thread, the oldest are overwritten first
+    inline const unsigned int RING_SIZE = 1 << 15;
+
+    // one finished zone; atomic fields so write() may read a slot the owner is refilling
+    struct Event
+    {
+        std::atomic<const char*> name{ nullptr };
+        std::atomic<int64_t> start{ 0 };
+        std::atomic<int64_t> end{ 0 };
+    };
+
+    struct Ring
+    {
+        enum State
+        {
+            ACTIVE,
+            // its thread exited, the zones are still written
+            RETIRED,
+            FREE
+        };
+
+        std::unique_ptr<Event[]> events{ new Event[RING_SIZE] };
+        // zones ever recorded, events[head % RING_SIZE] is the next slot
+        std::atomic<uint64_t> head{ 0 };
+        unsigned int id = 0;
+        std::string name;
+        State state = ACTIVE;
+    };
+
+    struct Registry
+    {
+        std::atomic<bool> recording{ false };
+        // only zones starting after this are written
+        std::atomic<int64_t> since{ 0 };
+        std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        std::mutex mutex;
+        // every ring ever allocated, FREE ones wait for the next recording thread
+        std::vector<std::unique_ptr<Ring>> rings;
+        // track ids, a reused ring gets a new one
+        unsigned int next_id = 1;
+    };
+
+    // never destroyed: threads of static pools return their rings in thread_local destructors,
+    // which may run after a static Registry would already be gone
+    inline Registry &registry()
+    {
+        static Registry *instance = new Registry;
+        return *instance;
+    }
+
+    // nanoseconds since the registry was created
+    inline int64_t now()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+    }
+
+    // per thread: the track name and the ring, which goes back to the registry on exit
+    struct ThreadState
+    {
+        std::string name;
+        Ring *ring = nullptr;
+
+        ~ThreadState()
+        {
+            if(!ring) return;
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            // a ring without zones has nothing to keep
+            ring->state = ring->head.load(std::memory_order_relaxed) ? Ring::RETIRED : Ring::FREE;
+        }
+    };
+
+    inline ThreadState &thread_state()
+    {
+        thread_local ThreadState state;
+        return state;
+    }
+
+    // the calling thread's ring, taken from the free ones or allocated on first use
+    // ------------------------------------------------------------------------
+    inline Ring &ring()
+    {
+        ThreadState &state = thread_state();
+        if(state.ring) return *state.ring;
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto free = std::find_if(r.rings.begin(), r.rings.end(), [](const std::unique_ptr<Ring> &ring){ return ring->state == Ring::FREE; });
+        if(free == r.rings.end()){
+            r.rings.push_back(std::make_unique<Ring>());
+            free = r.rings.end() - 1;
+        }
+        Ring &own = **free;
+        own.head.store(0, std::memory_order_relaxed);
+        own.state = Ring::ACTIVE;
+        own.id = r.next_id++;
+        own.name = state.name.empty() ? "Thread " + std::to_string(own.id) : state.name;
+        state.ring = &own;
+        return own;
+    }
+
+    // the track name of the calling thread, used once it records
+    inline void name_thread(const std::string &name)
+    {
+        ThreadState &state = thread_state();
+        state.name = name;
+        if(!state.ring) return;
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        state.ring->name = name;
+    }
+
+    inline bool recording()
+    {
+        return registry().recording.load(std::memory_order_relaxed);
+    }
+
+    // starts a new recording, zones from before are left out of the next write() and the
+    // rings of exited threads are freed for reuse
+    // ------------------------------------------------------------------------
+    inline void start()
+    {
+        Registry &r = registry();
+        {
+            std::lock_guard<std::mutex> lock(r.mutex);
+            for(std::unique_ptr<Ring> &ring : r.rings) if(ring->state == Ring::RETIRED) ring->state = Ring::FREE;
+        }
+        r.since.store(now(), std::memory_order_relaxed);
+        r.recording.store(true, std::memory_order_relaxed);
+    }
+
+    inline void stop()
+    {
+        registry().recording.store(false, std::memory_order_relaxed);
+    }
+
+    class Zone
+    {
+    public:
+        Zone(const char *name) : name(recording() ? name : nullptr)
+        {
+            if(this->name) start = now();
+        }
+        ~Zone()
+        {
+            if(!name) return;
+            Ring &own = ring();
+            uint64_t head = own.head.load(std::memory_order_relaxed);
+            Event &event = own.events[head % RING_SIZE];
+            event.name.store(name, std::memory_order_relaxed);
+            event.start.store(start, std::memory_order_relaxed);
+            event.end.store(now(), std::memory_order_relaxed);
+            own.head.store(head + 1, std::memory_order_release);
+        }
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char *name;
+        int64_t start = 0;
+    };
+
+    // names are literals of this program, only quotes and backslashes need escaping
+    inline std::string escape(const char *text)
+    {
+        std::string escaped;
+        for(; *text; text++){
+            if(*text == '"' || *text == '\\') escaped += '\\';
+            escaped += *text;
+        }
+        return escaped;
+    }
+
+    // writes the zones of the current or last recording as Chrome trace JSON
+    // ------------------------------------------------------------------------
+    inline bool write(const std::string &path)
+    {
+        std::ofstream file(path);
+        if(!file){
+            std::cout << "ERROR::TRACE::FILE_NOT_WRITABLE: " << path << std::endl;
+            return false;
+        }
+        Registry &r = registry();
+        int64_t since = r.since.load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> lock(r.mutex);
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"akceleracja\"}}";
+        std::size_t written = 0, tracks = 0;
+        char line[256];
+        for(const std::unique_ptr<Ring> &own : r.rings){
+            if(own->state == Ring::FREE) continue;
+            tracks++;
+            file << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << own->id << ",\"args\":{\"name\":\"" << escape(own->name.c_str()) << "\"}}";
+            file << ",\n{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":1,\"tid\":" << own->id << ",\"args\":{\"sort_index\":" << own->id << "}}";
+            uint64_t head = own->head.load(std::memory_order_acquire);
+            uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+            std::vector<std::pair<const char*, std::pair<int64_t, int64_t>>> copied;
+            copied.reserve(head - first);
+            for(uint64_t k = first; k < head; k++){
+                const Event &event = own->events[k % RING_SIZE];
+                copied.push_back({ event.name.load(std::memory_order_relaxed),
+                                   { event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed) } });
+            }
+            // slots the owner reached again during the copy hold newer zones, drop them, and
+            // the one it may be filling right now
+            uint64_t after = own->head.load(std::memory_order_acquire) + 1;
+            uint64_t valid = after > RING_SIZE ? std::max(first, after - RING_SIZE) : first;
+            for(uint64_t k = valid; k < head; k++){
+                const auto &event = copied[k - first];
+                if(!event.first || event.second.first < since) continue;
+                std::snprintf(line, sizeof(line), ",\n{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                              escape(event.first).c_str(), own->id, event.second.first / 1e3, (event.second.second - event.second.first) / 1e3);
+                file << line;
+                written++;
+            }
+        }
+        file << "\n]}\n";
+        std::cout << "wrote " << written << " trace zones of " << tracks << " threads to " << path << std::endl;
+        return static_cast<bool>(file);
+    }
+}
+#endif
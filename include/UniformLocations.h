@@ -0,0 +1,83 @@
+#ifndef UNIFORM_LOCATIONS_H
+#define UNIFORM_LOCATIONS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Uniform of a linked program with its location resolved once. Uses the glProgramUniform*
+// entry points, so setting it neither queries the driver nor needs the program bound.
+struct Uniform
+{
+    GLuint program = 0;
+    GLint location = -1;
+
+    bool valid() const { return location != -1; }
+    void set(bool value) const { glProgramUniform1i(program, location, (int)value); }
+    void set(int value) const { glProgramUniform1i(program, location, value); }
+    void set(unsigned int value) const { glProgramUniform1ui(program, location, value); }
+    void set(float value) const { glProgramUniform1f(program, location, value); }
+    void set(const glm::vec2 &value) const { glProgramUniform2fv(program, location, 1, &value[0]); }
+    void set(const glm::vec3 &value) const { glProgramUniform3fv(program, location, 1, &value[0]); }
+    void set(const glm::vec4 &value) const { glProgramUniform4fv(program, location, 1, &value[0]); }
+    void set(const glm::mat4 &value) const { glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, &value[0][0]); }
+};
+
+// Name -> location table of a program, filled from the program interface right after linking.
+// Lookups take a string_view, so passing a literal costs one hash and no allocation. Arrays
+// are reported as "name[0]" and answer to "name" as well; names the reflection did not list
+// (other array elements) are asked from the driver once and remembered, unknown ones map to
+// -1, which glUniform* ignores just like before.
+class UniformLocations
+{
+public:
+    // ------------------------------------------------------------------------
+    void reflect(GLuint program)
+    {
+        locations.clear();
+        this->program = program;
+        GLint count = 0, max_length = 0;
+        glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &max_length);
+        std::vector<char> name(max_length + 1);
+        for(GLint i = 0; i < count; i++){
+            const GLenum property = GL_LOCATION;
+            GLint location = -1;
+            glGetProgramResourceiv(program, GL_UNIFORM, i, 1, &property, 1, NULL, &location);
+            // members of uniform blocks have no location
+            if(location < 0) continue;
+            glGetProgramResourceName(program, GL_UNIFORM, i, (GLsizei)name.size(), NULL, name.data());
+            std::string uniform(name.data());
+            locations[uniform] = location;
+            if(uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) locations[uniform.substr(0, uniform.size() - 3)] = location;
+        }
+    }
+
+    GLint operator[](std::string_view name) const
+    {
+        auto found = locations.find(name);
+        if(found != locations.end()) return found->second;
+        std::string key(name);
+        GLint location = glGetUniformLocation(program, key.c_str());
+        locations.emplace(std::move(key), location);
+        return location;
+    }
+
+    std::size_t size() const { return locations.size(); }
+
+private:
+    // transparent hashing lets find() take the string_view without building a std::string
+    struct Hash
+    {
+        using is_transparent = void;
+        std::size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+    GLuint program = 0;
+    mutable std::unordered_map<std::string, GLint, Hash, std::equal_to<>> locations;
+};
+#endif
@@ -0,0 +1,144 @@
+#ifndef WORKGROUP_TUNER_H
+#define WORKGROUP_TUNER_H
+
+#include <glad/glad.h>
+
+#include <ComputeShader.h>
+#include <ComputeIFS.h>
+#include <IFS.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Picks local_size_x for shaders/shader.comp by timing a set of candidates on the current
+// device. The best size depends on the GPU (warp/wavefront width, register pressure) and on
+// Mesa's llvmpipe on the host's SIMD width, so the winner is cached in a small text file,
+// one "size vendor | renderer | version" line per device, and only re-measured on demand.
+class WorkgroupTuner
+{
+public:
+    struct Result
+    {
+        unsigned int local_size;
+        double ms;
+    };
+
+    // shader.comp's own default, used until a size has been measured
+    static constexpr unsigned int DEFAULT_SIZE = 64;
+    // points timed per candidate, enough to fill any GPU without making startup slow on llvmpipe
+    static constexpr unsigned int SAMPLE_POINTS = 1 << 18;
+
+    WorkgroupTuner(std::string shaderPath, std::string cachePath = "workgroup_sizes.txt") : shaderPath(shaderPath), cachePath(cachePath) {}
+
+    // defines for the ComputeShader constructor
+    static std::string defines(unsigned int local_size)
+    {
+        return "#define LOCAL_SIZE_X " + std::to_string(local_size) + "\n";
+    }
+
+    // identifies the driver and device of the current context
+    static std::string device_key()
+    {
+        auto text = [](GLenum name){
+            const char *value = (const char*)glGetString(name);
+            return std::string(value ? value : "unknown");
+        };
+        return text(GL_VENDOR) + " | " + text(GL_RENDERER) + " | " + text(GL_VERSION);
+    }
+
+    // cached size for the current device, 0 if it was never tuned
+    // ------------------------------------------------------------------------
+    unsigned int cached() const
+    {
+        std::ifstream file(cachePath);
+        std::string line, key = device_key();
+        while(std::getline(file, line)){
+            std::istringstream stream(line);
+            unsigned int size;
+            if(!(stream >> size)) continue;
+            stream.get();
+            std::string device;
+            std::getline(stream, device);
+            if(device == key) return size;
+        }
+        return 0;
+    }
+
+    // Times every power of two local size the device allows on `count` points of the positions
+    // bound to SSBO binding 0 (they get iterated, which keeps them on the attractor), stores
+    // the fastest in the cache and returns it.
+    // ------------------------------------------------------------------------
+    unsigned int tune(const IFS &fractal, unsigned int count, unsigned int repetitions = 3)
+    {
+        GLint max_invocations = 0, max_size_x = 0;
+        glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &max_invocations);
+        glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &max_size_x);
+        unsigned int limit = static_cast<unsigned int>(std::min(max_invocations, max_size_x));
+
+        measurements.clear();
+        int seed = 0;
+        for(unsigned int local_size = 16; local_size <= std::min(limit, 1024u); local_size *= 2){
+            ComputeShader candidate(shaderPath.c_str(), defines(local_size));
+            if(candidate.invocations() != local_size){
+                glDeleteProgram(candidate.ID);
+                continue;
+            }
+            // warm-up run absorbs the driver's deferred compilation
+            compute_ifs_shader(candidate, fractal, count, 1, seed);
+            glFinish();
+            double best = 1e30;
+            for(unsigned int r = 0; r < repetitions; r++){
+                auto start = std::chrono::steady_clock::now();
+                compute_ifs_shader(candidate, fractal, count, 1, seed);
+                glFinish();
+                best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+            glDeleteProgram(candidate.ID);
+            measurements.push_back({ local_size, best });
+        }
+        if(measurements.empty()) return DEFAULT_SIZE;
+
+        Result fastest = *std::min_element(measurements.begin(), measurements.end(), [](const Result &a, const Result &b){ return a.ms < b.ms; });
+        for(const Result &result : measurements){
+            std::cout << "local_size_x " << result.local_size << ": " << result.ms << " ms" << (result.local_size == fastest.local_size ? " <-" : "") << std::endl;
+        }
+        store(fastest.local_size);
+        return fastest.local_size;
+    }
+
+    // timings of the last tune()
+    const std::vector<Result> &results() const { return measurements; }
+
+private:
+    std::string shaderPath;
+    std::string cachePath;
+    std::vector<Result> measurements;
+
+    void store(unsigned int local_size) const
+    {
+        std::string key = device_key();
+        std::vector<std::string> lines;
+        {
+            std::ifstream file(cachePath);
+            std::string line;
+            while(std::getline(file, line)){
+                std::string::size_type space = line.find(' ');
+                if(space != std::string::npos && line.substr(space + 1) == key) continue;
+                if(!line.empty()) lines.push_back(line);
+            }
+        }
+        lines.push_back(std::to_string(local_size) + " " + key);
+        std::ofstream file(cachePath);
+        if(!file){
+            std::cout << "Warning: could not write the workgroup size cache " << cachePath << std::endl;
+            return;
+        }
+        for(const std::string &line : lines) file << line << "\n";
+    }
+};
+#endif
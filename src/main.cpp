@@ -9,6 +9,17 @@
 #include <stb_image.h>
 #include <camera.h>
 #include <ComputeShader.h>
+#include <ComputeIFS.h>
+#include <WorkgroupTuner.h>
+#include <StreamBuffer.h>
+#include <StageTimer.h>
+#include <Trace.h>
+#include <PointStore.h>
+#include <PointFormat.h>
+#include <IFS.h>
+#include <DensityHistogram.h>
+#include <ThreadPool.h>
+#include <CounterRng.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -20,14 +31,12 @@
 #include <map>  
 #include <thread>
 #include <chrono>
+#include <cstring>
 #include <random>
 #include <vector>
+#include <memory>
 #include <print>
 
-#define N_FUNCTIONS 3
-#define N_DIMENSIONS 2
-#define N_VARS 4
-
 void imgui_init(float main_scale);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn);
@@ -40,22 +49,22 @@ void render();
 unsigned int loadTexture(char const * path);
 void texture_setup();
 
-void compute_bransley(float *vertices);
-void compute_sierpinski(float *vertices);
-void compute_threaded(float * vertices);
-void thread_compute(float *vertices, unsigned int  start, unsigned int  end);
-void compute_random(float *vertices);
-void compute_random_but_cooler(float *vertices);
-void compute_with_shader(float *vertices,ComputeShader &computeShader);
-void compute_bransley_shader(float *vertices,ComputeShader &computeShader);
+void compute_cpu(PointStore &points);
+void compute_threaded(PointStore &points);
+void compute_simd(PointStore &points);
+void compute_with_shader(float *vertices,ComputeShader &computeShader, unsigned int splat_iterations = 0);
+void resize_density(unsigned int &texture, int width, int height);
+void clear_density(unsigned int texture, unsigned int stats);
+void upload_density(unsigned int texture, unsigned int stats);
+void cull_with_shader(ComputeShader &cullShader, unsigned int source, std::size_t offset, unsigned int point_bytes, unsigned int visible, unsigned int command, const glm::mat4 &model);
 
 void renderQuad();
 float generateFloat();
 void fill_transform();
-void fill_bransley();
-void fill_sierpinski();
+void load_preset(int preset);
+void reset_accumulation();
 void imgui_matrix(unsigned int transform_number, const char *name);
-void generate_points(float *vertices);
+void generate_points(PointStore &points);
 
 
 
@@ -86,24 +95,69 @@ unsigned int iterations = 10;
 float low = 0.0f;
 float high = 1.0f;
 
-int number_of_threads = 32;
+int number_of_threads = ThreadPool::default_size();
+ThreadPool pool(number_of_threads);
 thread_local std::mt19937 generator;
-thread_local std::uniform_int_distribution<int> distribution(0, 2); 
-std::uniform_real_distribution<> dis(-1.0, 1.0); 
+// seed of the counter-based RNG used by the CPU kernels, advanced once per frame
+uint32_t frame_seed = 0;
+// fused, cache-blocked iteration for the CPU backends
+IterationOptions iteration_options;
 
 
 
 bool gpu_compute = false;
-
-float random_transform[N_FUNCTIONS][N_DIMENSIONS][N_VARS];
-glm::mat4 transforms[N_FUNCTIONS];
-glm::mat4 bransley_transform[4];
-glm::mat4 sierpinski_transform[3];
+// all iterations in one compute dispatch, off falls back to a dispatch per iteration
+bool gpu_single_pass = true;
+
+// the fractal every backend iterates, selected from the presets below or randomized
+IFS fractal = IFS::sierpinski();
+const char *preset_names[] = { "Sierpinski", "Barnsley fern", "Sierpinski tetrahedron", "Random scaling", "Random" };
+int fractal_preset = 0;
+
+// per-pixel hit counts of the iterated points, tone-mapped by quad.fs instead of drawing GL_POINTS
+DensityHistogram histogram;
+bool draw_density = true;
+float density_gamma = 2.2f;
+float density_brightness = 1.0f;
+// progressive mode keeps adding frames to the histogram until the view or the fractal changes
+bool progressive = true;
+bool accumulation_dirty = true;
+unsigned int accumulated_frames = 0;
+double accumulated_samples = 0.0;
+// GPU density: every iterate of a frame is splatted by shader.comp, not just the last one
+bool splat_every_iteration = true;
+
+// layout of the GPU copies of the points, the compact ones only apply to 2D fractals
+PointFormat point_storage = PointFormat::VEC2;
+// box of the 16-bit storage, recomputed with the fractal
+glm::vec4 point_bounds(0.0f, 0.0f, 1.0f, 1.0f);
+bool point_bounds_dirty = true;
+// GL_POINTS draws only the points inside the view frustum, compacted by shaders/cull.comp
+bool cull_points = true;
+
+// CPU and GPU time per stage of the render loop, shown in the "Stage timings" window
+StageTimer stage_timer;
+// Chrome trace of the loop's zones: --trace FILE records from startup and writes FILE on exit,
+// F9 or the "Record trace" button starts a recording and the second press writes it
+std::string trace_path = "trace.json";
+bool trace_key_down = false;
+void toggle_trace();
 
 unsigned int VBO, VAO;
 
-int main()
+int main(int argc, char **argv)
 {
+    trace::name_thread("Main");
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc){
+            trace_path = argv[++i];
+            trace::start();
+        } else {
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << argv[i] << std::endl;
+            return -1;
+        }
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
@@ -162,19 +216,18 @@ int main()
     // ------------------------------------
     Shader shader("shaders/shader.vs", "shaders/shader.fs");
     Shader screenQuad("shaders/quad.vs", "shaders/quad.fs");
-    ComputeShader computeShader("shaders/shader.comp");   
     
    
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
-    fill_transform();
-    
+    // the kernels work on x/y arrays, vertices is only the staging copy for the upload, sized
+    // for the current point format by set_buffer_format()
+    PointStore points(number_of_points);
     float *vertices = new float[number_of_vertices]; 
     
-    generate_points(vertices);
-    fill_sierpinski();
-    fill_bransley();
+    generate_points(points);
+    points.pack_vec4(vertices);
     
 
     glCreateBuffers(1, &VBO);
@@ -198,6 +251,72 @@ int main()
     // VAOs requires a call to glBindVertexArray anyways so we generally don't unbind VAOs (nor VBOs) when it's not directly necessary.
     glBindVertexArray(0); 
 
+    // CPU points are packed straight into a persistently mapped ring, see StreamBuffer.h;
+    // vec4 like VBO until set_buffer_format() picks the storage format
+    StreamBuffer stream(sizeof(float) * number_of_vertices);
+    float upload_gbps = 0.0f;
+    float upload_stall_ms = 0.0f;
+
+    // the compute shader's work group size is measured once per device, the SSBO above
+    // doubles as the benchmark input
+    WorkgroupTuner tuner("shaders/shader.comp");
+    unsigned int local_size = tuner.cached();
+    if(local_size == 0) local_size = tuner.tune(fractal, std::min(number_of_points, WorkgroupTuner::SAMPLE_POINTS));
+    std::unique_ptr<ComputeShader> computeShader;
+    // the same kernel binning its iterates straight into the density texture
+    std::unique_ptr<ComputeShader> splatShader;
+    // compacts the visible points for the indirect draw, built for the same point format
+    std::unique_ptr<ComputeShader> cullShader;
+    // layout VBO currently holds, the one the VAO and both kernels are set up for
+    PointFormat buffer_format = PointFormat::VEC4;
+    auto build_compute_shaders = [&](){
+        std::string defines = WorkgroupTuner::defines(local_size) + point_format::defines(buffer_format);
+        if(computeShader) glDeleteProgram(computeShader->ID);
+        if(splatShader) glDeleteProgram(splatShader->ID);
+        if(cullShader) glDeleteProgram(cullShader->ID);
+        computeShader = std::make_unique<ComputeShader>("shaders/shader.comp", defines);
+        splatShader = std::make_unique<ComputeShader>("shaders/shader.comp", defines + "#define SPLAT\n");
+        cullShader = std::make_unique<ComputeShader>("shaders/cull.comp", point_format::defines(buffer_format));
+    };
+    build_compute_shaders();
+    // the visible points in any point format and the glDrawArraysIndirect command counting them
+    unsigned int visibleBuffer = 0, drawCommand;
+    auto allocate_visible = [&](PointFormat format){
+        if(visibleBuffer) glDeleteBuffers(1, &visibleBuffer);
+        glCreateBuffers(1, &visibleBuffer);
+        glNamedBufferStorage(visibleBuffer, (GLsizeiptr)point_format::bytes(format) * number_of_points, NULL, 0);
+    };
+    allocate_visible(buffer_format);
+    glCreateBuffers(1, &drawCommand);
+    glNamedBufferStorage(drawCommand, 4 * sizeof(GLuint), NULL, GL_DYNAMIC_STORAGE_BIT);
+    // repacks the CPU points into VBO in another layout, resizes every per-point buffer to
+    // it and switches the VAO and the kernels over; the GPU points restart from the CPU ones
+    auto set_buffer_format = [&](PointFormat format){
+        buffer_format = format;
+        if(format == PointFormat::UNORM16) point_bounds = fractal.bounds();
+        const std::size_t bytes = (std::size_t)point_format::bytes(format) * number_of_points;
+        delete[] vertices;
+        vertices = new float[bytes / sizeof(float)];
+        point_format::pack(points, format, vertices, point_bounds);
+        glNamedBufferData(VBO, (GLsizeiptr)bytes, vertices, GL_DYNAMIC_DRAW);
+        stream.resize(bytes);
+        allocate_visible(format);
+        point_format::attribute(VAO, format);
+        build_compute_shaders();
+        reset_accumulation();
+    };
+
+    // projection and view shared by shader.vs and the splatting shader.comp, layout(std140, binding = 0) Camera
+    unsigned int cameraUBO;
+    glCreateBuffers(1, &cameraUBO);
+    glNamedBufferStorage(cameraUBO, 2 * sizeof(glm::mat4), NULL, GL_DYNAMIC_STORAGE_BIT);
+    glBindBufferBase(GL_UNIFORM_BUFFER, 0, cameraUBO);
+
+    // density texture (sized to the framebuffer in the render loop) and its max_hits counter
+    unsigned int densityTexture = 0;
+    unsigned int densityStats;
+    glCreateBuffers(1, &densityStats);
+    glNamedBufferData(densityStats, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
 
     // draw as wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -210,13 +329,15 @@ int main()
     //std::println("{} \n", glm::to_string(transforms[0]));
     // render loop
     // -----------
-    bool show_matrix1 = false;
-    bool show_matrix2 = false;
-    bool show_matrix3 = false;
+    bool show_matrix[MapTable::MAX_MAPS] = {};
 
     bool cpu = true;
     bool cpu_threaded = false;
+    bool cpu_simd = false;
     bool gpu = false;
+    float compute_ms = 0.0f;
+    const unsigned int min_block_size = PointStore::PADDING;
+    const unsigned int max_block_size = 1 << 20;
     
 
     static bool ref_color = false;
@@ -237,6 +358,7 @@ int main()
             ImGui_ImplGlfw_Sleep(10);
             continue;
         }
+        trace::Zone frame_zone("Frame");
 
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
@@ -257,7 +379,11 @@ int main()
         // input
         // -----
         //if (!io.MouseHoveredViewport) 
-        processInput(window);
+        stage_timer.new_frame();
+        {
+            StageTimer::Scope scope(stage_timer, "Input", false);
+            processInput(window);
+        }
         
 
         
@@ -272,66 +398,234 @@ int main()
         model = glm::translate(model, glm::vec3(2.0f, 0.0f, 0.0f)); 
         model = glm::scale(model, glm::vec3(1.0f)); 
 
-        shader.setVec4("color", glm::vec4(color.x,color.y,color.z,color.w));
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-        shader.setMat4("model", model);
-        //compute_bransley(vertices);
-        if(cpu) compute_sierpinski(vertices); 
-        if(cpu_threaded) compute_threaded(vertices);
-        //compute_random_but_cooler(vertices);
-        if(gpu) compute_with_shader(vertices, computeShader);
-        //compute_bransley_shader(vertices,computeShader);
-        shader.use();
-        if(!gpu){
-            glBindBuffer(GL_ARRAY_BUFFER, VBO); 
-            glBufferData(GL_ARRAY_BUFFER, sizeof(float) * number_of_vertices, vertices, GL_DYNAMIC_DRAW);
+        // one upload of the camera matrices for every program that includes the Camera block
+        glNamedBufferSubData(cameraUBO, 0, sizeof(glm::mat4), &projection[0][0]);
+        glNamedBufferSubData(cameraUBO, sizeof(glm::mat4), sizeof(glm::mat4), &view[0][0]);
+        // presets and randomizing can switch between 2D and 3D fractals
+        if(points.dimensions() != fractal.dimensions) points.set_dimensions(fractal.dimensions);
+        PointFormat wanted_format = point_format::effective(point_storage, fractal.dimensions);
+        if(wanted_format != buffer_format) set_buffer_format(wanted_format);
+        // the GPU points are decoded with the box they were stored in and re-encoded in the new one
+        glm::vec4 decode_bounds = point_bounds;
+        if(point_bounds_dirty){
+            if(buffer_format == PointFormat::UNORM16) point_bounds = fractal.bounds();
+            point_bounds_dirty = false;
+        }
+        int display_w, display_h;
+        glfwGetFramebufferSize(window, &display_w, &display_h);
+        const bool density = draw_density && display_w > 0 && display_h > 0;
+        if(density){
+            if(histogram.width() != (unsigned int)display_w || histogram.height() != (unsigned int)display_h){
+                histogram.resize(display_w, display_h);
+                resize_density(densityTexture, display_w, display_h);
+                reset_accumulation();
+            }
+            if(accumulation_dirty || !progressive){
+                histogram.clear();
+                clear_density(densityTexture, densityStats);
+                accumulation_dirty = false;
+                accumulated_frames = 0;
+                accumulated_samples = 0.0;
+            }
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, densityStats);
+            glBindImageTexture(0, densityTexture, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+        }
+        auto compute_start = std::chrono::steady_clock::now();
+        frame_seed++;
+        {
+            StageTimer::Scope scope(stage_timer, "Compute");
+            if(cpu) compute_cpu(points); 
+            if(cpu_threaded) compute_threaded(points);
+            if(cpu_simd) compute_simd(points);
+            if(gpu){
+                ComputeShader &kernel = density ? *splatShader : *computeShader;
+                kernel.uniform("u_decode_bounds").set(decode_bounds);
+                kernel.uniform("u_encode_bounds").set(point_bounds);
+                if(density){
+                    // right after a reset the points may still lie on the previous attractor,
+                    // that frame only splats their final positions
+                    unsigned int splat_iterations = splat_every_iteration && accumulated_frames > 0 ? iterations : 1;
+                    kernel.uniform("u_model").set(model);
+                    compute_with_shader(vertices, kernel, splat_iterations);
+                    accumulated_samples += (double)number_of_points * splat_iterations;
+                } else {
+                    compute_with_shader(vertices, kernel);
+                }
+            }
+        }
+        // smoothed so the readout stays legible; GPU work is asynchronous and only counted as submission time
+        float frame_compute_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - compute_start).count();
+        compute_ms = compute_ms * 0.95f + frame_compute_ms * 0.05f;
+        if(density){
+            // GPU points were splatted by the compute pass and never leave the SSBO, CPU
+            // points are binned where they are and only the histogram is uploaded
+            if(!gpu){
+                glm::mat4 mvp = projection * view * model;
+                {
+                    StageTimer::Scope scope(stage_timer, "Histogram");
+                    histogram.accumulate(pool, points, 0, number_of_points, mvp);
+                }
+                StageTimer::Scope scope(stage_timer, "Upload");
+                upload_density(densityTexture, densityStats);
+                accumulated_samples += number_of_points;
+            }
+            accumulated_frames++;
+            StageTimer::Scope scope(stage_timer, "Tone map");
+            screenQuad.use();
+            screenQuad.setInt("u_density", 0);
+            screenQuad.setVec4("color", glm::vec4(color.x, color.y, color.z, color.w));
+            screenQuad.setVec3("background", glm::vec3(color.x / 2, color.y / 2, color.z / 2));
+            screenQuad.setFloat("gamma", density_gamma);
+            screenQuad.setFloat("brightness", density_brightness);
+            glBindTextureUnit(0, densityTexture);
+            renderQuad();
+        } else {
+            shader.use();
+            shader.setVec4("color", glm::vec4(color.x,color.y,color.z,color.w));
+            shader.setMat4("model", model);
+            shader.setVec4("bounds", point_format::vertex_bounds(buffer_format, point_bounds));
+            const unsigned int point_bytes = point_format::bytes(buffer_format);
+            // where this frame's points are, drawn directly or through the culling pass; the
+            // GPU ones never leave VBO
+            unsigned int source = VBO;
+            std::size_t source_offset = 0;
+            if(!gpu && stream.valid()){
+                StageTimer::Scope scope(stage_timer, "Upload");
+                float *segment = static_cast<float*>(stream.begin());
+                auto upload_start = std::chrono::steady_clock::now();
+                point_format::pack(points, buffer_format, segment, point_bounds);
+                float upload_seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - upload_start).count();
+                upload_gbps = upload_gbps * 0.95f + 0.05f * point_bytes * number_of_points / (upload_seconds * 1e9f);
+                upload_stall_ms = upload_stall_ms * 0.95f + 0.05f * stream.stall_ms();
+                source = stream.ID;
+                source_offset = stream.offset();
+            } else if(!gpu){
+                StageTimer::Scope scope(stage_timer, "Upload");
+                point_format::pack(points, buffer_format, vertices, point_bounds);
+                glBindBuffer(GL_ARRAY_BUFFER, VBO); 
+                glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)point_bytes * number_of_points, vertices, GL_DYNAMIC_DRAW);
+            }
+            if(cull_points){
+                StageTimer::Scope scope(stage_timer, "Cull");
+                cull_with_shader(*cullShader, source, source_offset, point_bytes, visibleBuffer, drawCommand, model);
+                glVertexArrayVertexBuffer(VAO, 0, visibleBuffer, 0, point_bytes);
+            } else {
+                glVertexArrayVertexBuffer(VAO, 0, source, source_offset, point_bytes);
+            }
+            {
+                StageTimer::Scope scope(stage_timer, "Draw points");
+                glBindVertexArray(VAO);
+                if(cull_points){
+                    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, drawCommand);
+                    glDrawArraysIndirect(GL_POINTS, NULL);
+                } else {
+                    glDrawArrays(GL_POINTS, 0, number_of_points);
+                }
+            }
+            if(!gpu && stream.valid()) stream.end();
         }
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_POINTS, 0, number_of_points);
         
         
-        ImGui::Begin("Tools");
-        ImGui::Checkbox("Transform 1", &show_matrix1);
-        ImGui::SameLine();
-        ImGui::Checkbox("Transform 2", &show_matrix2);
-        ImGui::SameLine();
-        ImGui::Checkbox("Transform 3", &show_matrix3);
-        ImGui::NewLine();
-        ImGui::Checkbox("CPU", &cpu);
-        ImGui::SameLine();
-        ImGui::Checkbox("CPU Threaded", &cpu_threaded);
-        ImGui::SameLine();
-        ImGui::Checkbox("GPU", &gpu);
-        ImGui::ColorPicker4("MyColor##4", (float*)&color, flags, ref_color ? &ref_color_v.x : NULL);
-        ImGui::NewLine();
-        if(show_matrix1) imgui_matrix(0, "Transform 1");
-        if(show_matrix2) imgui_matrix(1, "Transform 2");
-        if(show_matrix3) imgui_matrix(2, "Transform 3");
-        if(ImGui::Button("Randomize!")) fill_transform();
-        ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+        {
+            StageTimer::Scope scope(stage_timer, "ImGui build", false);
+            ImGui::Begin("Tools");
+            if(ImGui::Combo("Fractal", &fractal_preset, preset_names, IM_ARRAYSIZE(preset_names))) load_preset(fractal_preset);
+            char transform_names[MapTable::MAX_MAPS][16];
+            for(unsigned int k = 0; k < fractal.size(); k++){
+                snprintf(transform_names[k], sizeof(transform_names[k]), "Transform %u", k + 1);
+                if(k % 4 != 0) ImGui::SameLine();
+                ImGui::Checkbox(transform_names[k], &show_matrix[k]);
+            }
+            ImGui::NewLine();
+            ImGui::Checkbox("CPU", &cpu);
+            ImGui::SameLine();
+            ImGui::Checkbox("CPU Threaded", &cpu_threaded);
+            ImGui::SameLine();
+            ImGui::Checkbox("CPU SIMD", &cpu_simd);
+            ImGui::SameLine();
+            // the CPU histogram and the GPU texture are separate accumulations
+            if(ImGui::Checkbox("GPU", &gpu)) reset_accumulation();
+            ImGui::SameLine();
+            ImGui::Checkbox("Single pass", &gpu_single_pass);
+            if(ImGui::SliderInt("Threads", &number_of_threads, 1, 2 * ThreadPool::default_size())) pool.resize(number_of_threads);
+            ImGui::Checkbox("Fuse iterations", &iteration_options.fused);
+            ImGui::SameLine();
+            ImGui::SliderScalar("Block size", ImGuiDataType_U32, &iteration_options.block_size, &min_block_size, &max_block_size, "%u", ImGuiSliderFlags_Logarithmic);
+            ImGui::Checkbox("Density", &draw_density);
+            ImGui::SameLine();
+            ImGui::Checkbox("Progressive", &progressive);
+            ImGui::SameLine();
+            ImGui::Text("%u frames, %.1f Msamples", accumulated_frames, accumulated_samples / 1e6);
+            ImGui::SameLine();
+            ImGui::Checkbox("Splat every iteration", &splat_every_iteration);
+            ImGui::SliderFloat("Gamma", &density_gamma, 1.0f, 4.0f);
+            ImGui::SliderFloat("Brightness", &density_brightness, 0.1f, 4.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+            ImGui::ColorPicker4("MyColor##4", (float*)&color, flags, ref_color ? &ref_color_v.x : NULL);
+            ImGui::NewLine();
+            for(unsigned int k = 0; k < fractal.size(); k++){
+                if(show_matrix[k]) imgui_matrix(k, transform_names[k]);
+            }
+            if(ImGui::Button("Randomize!")) fill_transform();
+            ImGui::SameLine();
+            ImGui::Checkbox("Stage timings", &stage_timer.enabled);
+            ImGui::SameLine();
+            if(ImGui::Button(trace::recording() ? "Write trace" : "Record trace")) toggle_trace();
+            ImGui::SameLine();
+            ImGui::Checkbox("Cull points", &cull_points);
+            ImGui::SameLine();
+            if(ImGui::Button("Tune workgroup size")){
+                // the candidates iterate the buffer as vec4s, as many as fit into it in the current
+                // format; the points are restored afterwards
+                unsigned int vec4_points = point_format::bytes(buffer_format) * number_of_points / point_format::bytes(PointFormat::VEC4);
+                local_size = tuner.tune(fractal, std::min(vec4_points, WorkgroupTuner::SAMPLE_POINTS));
+                set_buffer_format(buffer_format);
+            }
+            ImGui::SameLine();
+            ImGui::Text("local_size_x = %u", local_size);
+            int storage = static_cast<int>(point_storage);
+            if(ImGui::Combo("Point storage", &storage, point_format::NAMES, IM_ARRAYSIZE(point_format::NAMES))) point_storage = static_cast<PointFormat>(storage);
+            ImGui::SameLine();
+            ImGui::Text("%s, %.1f MB", point_format::name(buffer_format), point_format::bytes(buffer_format) * (double)number_of_points / 1e6);
+            ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / io.Framerate, io.Framerate);
+            if(!draw_density && !gpu) ImGui::Text("Upload %.2f GB/s, stall %.3f ms/frame", upload_gbps, upload_stall_ms);
+            ImGui::Text("Compute %.3f ms/frame (%.1f Mpoints/s), SIMD: %s", compute_ms, compute_ms > 0.0f ? number_of_points * iterations / (compute_ms * 1000.0f) : 0.0f, simd_level_name(simd_level()));
         
-        ImGui::End();
+            ImGui::End();
+            stage_timer.draw();
+        }
 
         
         // Rendering
-        ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(window, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        {
+            StageTimer::Scope scope(stage_timer, "ImGui");
+            ImGui::Render();
+            glViewport(0, 0, display_w, display_h);
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
         
         
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
+        {
+            StageTimer::Scope scope(stage_timer, "Swap", false);
+            glfwSwapBuffers(window);
+        }
         glfwPollEvents();
     }
 
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
+    if(trace::recording()) toggle_trace();
+    stream.release();
+    stage_timer.release();
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &visibleBuffer);
+    glDeleteBuffers(1, &drawCommand);
+    glDeleteBuffers(1, &densityStats);
+    glDeleteBuffers(1, &cameraUBO);
+    if(densityTexture) glDeleteTextures(1, &densityTexture);
+    delete[] vertices;
 
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
@@ -350,6 +644,7 @@ int main()
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow *window)
 {
+    glm::vec3 position = camera.Position;
     if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -375,6 +670,22 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS && just_transformed) {
         just_transformed = false;
     }
+    // edge triggered, holding F9 toggles once
+    bool trace_key = glfwGetKey(window, GLFW_KEY_F9) == GLFW_PRESS;
+    if(trace_key && !trace_key_down) toggle_trace();
+    trace_key_down = trace_key;
+    if (camera.Position != position) reset_accumulation();
+}
+
+// starts a trace recording, or ends the running one and writes it to trace_path
+void toggle_trace(){
+    if(!trace::recording()){
+        trace::start();
+        std::cout << "recording trace, F9 again writes " << trace_path << std::endl;
+        return;
+    }
+    trace::stop();
+    trace::write(trace_path);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -407,11 +718,13 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn){
     lastY = ypos;
 
     camera.ProcessMouseMovement(xoffset, yoffset);
+    if (xoffset != 0.0f || yoffset != 0.0f) reset_accumulation();
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    reset_accumulation();
 }
 
 void imgui_init(float main_scale){
@@ -419,6 +732,7 @@ void imgui_init(float main_scale){
 }
 
 void imgui_matrix(unsigned int transform_number, const char *name){
+    bool changed = false;
     ImGui::Begin(name);
         if (ImGui::BeginTable("Matrix", 4))
         {
@@ -430,174 +744,36 @@ void imgui_matrix(unsigned int transform_number, const char *name){
                 {
                     ImGui::TableSetColumnIndex(column);
                     ImGui::PushID(id);
-                    ImGui::SliderFloat(" ", &transforms[transform_number][row][column], -1.0f, 1.0f);
+                    if(ImGui::SliderFloat(" ", &fractal.maps[transform_number].transform[row][column], -1.0f, 1.0f)) changed = true;
                     ImGui::PopID();
                     id++;
                 }
             }
             ImGui::EndTable();
         }        
+        if(ImGui::SliderFloat("Weight", &fractal.maps[transform_number].weight, 0.0f, 1.0f)) changed = true;
         ImGui::End();
-}
-
-
-void compute_bransley(float *vertices){
-    for(int i = 0; i < iterations; i++){
-        for(unsigned int j = 0; j < number_of_vertices; j+=4){
-            int choice = rand() % 4;
-            float V_x = vertices[j];
-            float V_y = vertices[j+1];
-            if (choice == 0){    
-                vertices[j] = 0.85f * V_x + 0.04f * V_y;
-                vertices[j + 1] = -0.04f * V_x + 0.85f * V_y + 1.60f;
-            }
-            if (choice == 1){
-                vertices[j] = -0.15f * V_x + 0.28f * V_y;
-                vertices[j + 1] = 0.26f * V_x + 0.24f * V_y + 0.44f;
-            }
-            if (choice == 2){
-                vertices[j] = 0.20f * V_x - 0.26f * V_y;
-                vertices[j + 1] = 0.23f * V_x + 0.22f * V_y + 1.60f;
-            }
-            if (choice == 3){
-                vertices[j] = 0.0f;
-                vertices[j + 1] = 0.16f * V_y;
-            }
-        }    
-    }
-}
-
-void compute_threaded(float *vertices){
-    std::vector<std::thread> threads;
-    threads.reserve(number_of_threads);
-
-    for(int i = 0; i < iterations; i++){
-        threads.clear();
-        for(int j = 0; j < number_of_threads; j++){
-            unsigned int start = (number_of_vertices/number_of_threads) * j;
-            unsigned int end = (number_of_vertices/number_of_threads) * (j + 1);
-            threads.emplace_back(std::thread(thread_compute, vertices, start, end));
+        if(changed){
+            fractal.rebuild();
+            reset_accumulation();
         }
-        for (auto& thread : threads) {
-            if(thread.joinable()) thread.join();
-        }    
-    }
 }
 
-void thread_compute(float *vertices, unsigned int  start, unsigned int  end){
-    generator.seed(std::chrono::high_resolution_clock::now().time_since_epoch().count() + start);
 
-    for(int j = start; j < end; j+=4){
-            int choice = distribution(generator);
-            float V_x = vertices[j];
-            float V_y = vertices[j+1];
-            if (choice == 0){    
-                vertices[j] = V_x/2;
-                vertices[j + 1] = V_y/2 + 0.36f;
-            }
-            if (choice == 1){
-                vertices[j] = V_x/2 - 0.5f;
-                vertices[j + 1] = V_y/2 - 0.5f;
-            }
-            if (choice == 2){
-                vertices[j] = V_x/2 + 0.5f;
-                vertices[j + 1] = V_y/2 - 0.5f;
-            }
-            // if (choice == 0){    
-            //     vertices[j] = 0.85f * V_x + 0.04f * V_y;
-            //     vertices[j + 1] = -0.04f * V_x + 0.85f * V_y + 1.60f;
-            // }
-            // if (choice == 1){
-            //     vertices[j] = -0.15f * V_x + 0.28f * V_y;
-            //     vertices[j + 1] = 0.26f * V_x + 0.24f * V_y + 0.44f;
-            // }
-            // if (choice == 2){
-            //     vertices[j] = 0.20f * V_x - 0.26f * V_y;
-            //     vertices[j + 1] = 0.23f * V_x + 0.22f * V_y + 1.60f;
-            // }
-            // if (choice == 3){
-            //     vertices[j] = 0.0f;
-            //     vertices[j + 1] = 0.16f * V_y;
-            // }
-        }
+// single-threaded scalar backend
+void compute_cpu(PointStore &points){
+    iterate_blocked(fractal.table(), points, 0, number_of_points, iterations, frame_seed, iteration_options, SimdLevel::Scalar);
 }
 
-void compute_sierpinski(float *vertices){
-    for(int i = 0; i < iterations; i++){
-        for(unsigned int j = 0; j < number_of_vertices; j+=4){
-            int choice = rand() % 3;
-            float V_x = vertices[j];
-            float V_y = vertices[j+1];
-            if (choice == 0){    
-                vertices[j] = V_x/2;
-                vertices[j + 1] = V_y/2 + 0.36f;
-            }
-            if (choice == 1){
-                vertices[j] = V_x/2 - 0.5f;
-                vertices[j + 1] = V_y/2 - 0.5f;
-            }
-            if (choice == 2){
-                vertices[j] = V_x/2 + 0.5f;
-                vertices[j + 1] = V_y/2 - 0.5f;
-            }
-        }
-        
-    }
-}
-
-void compute_random(float *vertices){
-    for(int i = 0; i < iterations; i++){
-        for(unsigned int j = 0; j < number_of_vertices; j+=4){
-            int choice = rand() % 3;
-            float V_x = vertices[j];
-            float V_y = vertices[j+1];
-            //float V_z = vertices[j+2];
-            if (choice == 0){    
-                vertices[j]     = (V_x * transforms[choice][0][0] + transforms[choice][0][3]);
-                vertices[j + 1] = (V_y * transforms[choice][1][1] + transforms[choice][1][3]);
-                //vertices[j + 2] = (V_z * transforms[choice][2][2] + transforms[choice][2][3]);
-            }
-            if (choice == 1){
-                vertices[j]     = (V_x * transforms[choice][0][0] + transforms[choice][0][3]);
-                vertices[j + 1] = (V_y * transforms[choice][1][1] + transforms[choice][1][3]);
-                //vertices[j + 2] = (V_z * transforms[choice][2][2] + transforms[choice][2][3]);
-            }
-            if (choice == 2){
-                vertices[j]     = (V_x * transforms[choice][0][0] + transforms[choice][0][3]);
-                vertices[j + 1] = (V_y * transforms[choice][1][1] + transforms[choice][1][3]);
-                //vertices[j + 2] = (V_z * transforms[choice][2][2] + transforms[choice][2][3]);
-            }
-        }
-    }
+// the points are independent, so every thread runs all iterations over its own chunk
+void compute_threaded(PointStore &points){
+    pool.parallel_for(0, number_of_points, PointStore::PADDING, [&](unsigned int start, unsigned int end, unsigned int){
+        iterate_blocked(fractal.table(), points, start, end, iterations, frame_seed, iteration_options, SimdLevel::Scalar);
+    }, "Iterate");
 }
 
-void compute_random_but_cooler(float *vertices){
-    for(int i = 0; i < iterations; i++){
-        for(unsigned int j = 0; j < number_of_vertices; j+=4){
-            int choice = rand() % 3;
-            float V_x = vertices[j];
-            float V_y = vertices[j+1];
-            //float V_z = vertices[j+2];
-            if (choice == 0){    
-                vertices[j] = (V_x *     random_transform[choice][0][0] + random_transform[choice][0][1]) 
-                            + (V_y *     random_transform[choice][0][2] + random_transform[choice][0][3]);
-                vertices[j + 1] = (V_x * random_transform[choice][1][0] + random_transform[choice][1][1]) 
-                            + (V_y *     random_transform[choice][1][2] + random_transform[choice][1][3]);
-            }
-            if (choice == 1){
-                vertices[j] = (V_x *     random_transform[choice][0][0] + random_transform[choice][0][1]) 
-                            + (V_y *     random_transform[choice][0][2] + random_transform[choice][0][3]);
-                vertices[j + 1] = (V_x * random_transform[choice][1][0] + random_transform[choice][1][1]) 
-                            + (V_y *     random_transform[choice][1][2] + random_transform[choice][1][3]);
-            }
-            if (choice == 2){
-                vertices[j] = (V_x *     random_transform[choice][0][0] + random_transform[choice][0][1]) 
-                            + (V_y *     random_transform[choice][0][2] + random_transform[choice][0][3]);
-                vertices[j + 1] = (V_x * random_transform[choice][1][0] + random_transform[choice][1][1]) 
-                            + (V_y *     random_transform[choice][1][2] + random_transform[choice][1][3]);
-            }
-        }   
-    }
+void compute_simd(PointStore &points){
+    iterate_blocked(fractal.table(), points, 0, number_of_points, iterations, frame_seed, iteration_options);
 }
 
 unsigned int quadVAO = 0;
@@ -634,139 +810,76 @@ float generateFloat(){
 }
 
 void fill_transform(){
-    // std::random_device rd;  // Will be used to obtain a seed for the random number engine
-    // std::mt19937 gen(rd()); // Standard mersenne_twister_engine seeded with rd()
-    // std::uniform_real_distribution<> dis(-1.0, 1.0); 
-    for( int i = 0; i < N_FUNCTIONS; i++) transforms[i] = glm::mat4(1.0f);
-    for(int i = 0; i < N_FUNCTIONS; i++){
-        for(int j = 0; j < N_DIMENSIONS; j++){
-            for(int k = 0; k < N_VARS; k++) {
-                random_transform[i][j][k] = (float)dis(generator);
-            }
-        }
-    }
-    for(int i = 0; i < N_FUNCTIONS; i++){
-        transforms[i] = glm::mat4(glm::vec4((float)dis(generator),0.0f,0.0f,(float)dis(generator)),
-                                  glm::vec4(0.0f,(float)dis(generator),0.0f,(float)dis(generator)),
-                                  glm::vec4(0.0f,0.0f,(float)dis(generator),(float)dis(generator)),
-                                  glm::vec4(0.0f,0.0f,0.0f,1.0f));
-        // transforms[i] = glm::mat4(glm::vec4((float)dis(gen),0.0f,0.0f,0.0f),
-        //                           glm::vec4(0.0f,(float)dis(gen),0.0f,0.0f),
-        //                           glm::vec4(0.0f,0.0f,1.0f,0.0f),
-        //                           glm::vec4((float)dis(gen),(float)dis(gen),0.0f,1.0f));
+    fractal = IFS::random(generator);
+    reset_accumulation();
+    fractal_preset = IM_ARRAYSIZE(preset_names) - 1;
+}
+
+void load_preset(int preset){
+    switch(preset){
+        case 0: fractal = IFS::sierpinski(); break;
+        case 1: fractal = IFS::barnsley(); break;
+        case 2: fractal = IFS::sierpinski_tetrahedron(); break;
+        case 3: fractal = IFS::random_scaling(generator); break;
+        default: fractal = IFS::random(generator); break;
     }
+    reset_accumulation();
 }
 
-void fill_bransley(){
-    bransley_transform[0] = glm::mat4(glm::vec4(0.85f,0.04f,0.0f,0.0f),
-                                      glm::vec4(-0.04f,0.85f,0.0f,1.60f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
-    bransley_transform[1] = glm::mat4(glm::vec4(-0.15f,0.28f,0.0f,0.0f),
-                                      glm::vec4(0.26f,0.24f,0.0f,0.44f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
-    bransley_transform[2] = glm::mat4(glm::vec4(0.20f,-0.26f,0.0f,0.0f),
-                                      glm::vec4(0.23f,0.22f,0.0f,1.60f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
-    bransley_transform[3] = glm::mat4(glm::vec4(0.0f,0.0f,0.0f,0.0f),
-                                      glm::vec4(0.0f,0.16f,0.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
+void compute_with_shader(float *vertices, ComputeShader &computeShader, unsigned int splat_iterations){
+    static int global_iteration_count = 0;
+
+    compute_ifs_shader(computeShader, fractal, number_of_points, iterations, global_iteration_count, gpu_single_pass, splat_iterations);
 }
 
-void fill_sierpinski(){
-    sierpinski_transform[0] = glm::mat4(glm::vec4(0.5f,0.00f,0.0f,0.0f),
-                                      glm::vec4(0.0f,0.5f,0.0f,0.36f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
-    sierpinski_transform[1] = glm::mat4(glm::vec4(0.5f,0.0f,0.0f,-0.5f),
-                                      glm::vec4(0.0f,0.5f,0.0f,-0.5f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
-    sierpinski_transform[2] = glm::mat4(glm::vec4(0.5f,0.0f,0.0f,0.5f),
-                                      glm::vec4(0.0f,0.5f,0.0f,-0.5f),
-                                      glm::vec4(0.0f,0.0f,1.0f,0.0f),
-                                      glm::vec4(0.0f,0.0f,0.0f,1.0f));
+void generate_points(PointStore &points){
+    points.generate(low, high);
 }
 
-void compute_with_shader(float *vertices, ComputeShader &computeShader){
-    static int global_iteration_count = 0;
+// (re)allocates the R32UI hit count texture to the framebuffer size
+void resize_density(unsigned int &texture, int width, int height){
+    if(texture) glDeleteTextures(1, &texture);
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_R32UI, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+}
 
-    computeShader.use();
-    GLint transform_array_location = glGetUniformLocation(computeShader.ID, "u_transformations[0]");
-    if(transform_array_location == -1){
-        std::cout << "Warning: uniform 'u_transformations[0]' not found (location = -1)." << std::endl;
-    } else {
-        glUniformMatrix4fv(transform_array_location, 3, GL_TRUE, glm::value_ptr(sierpinski_transform[0]));
-    }
-    for(int i = 0; i < iterations; i++){
-        global_iteration_count++;
-        computeShader.setInt("u_seed", global_iteration_count);
-
-        glDispatchCompute(number_of_points, 1, 1);
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
-
-        // const int LOG_INTERVAL = 60;
-        // const int N_PRINT = 10; // number of points (vec4) to print
-        // static int last_logged = 0;
-        // if ((global_iteration_count - last_logged) >= LOG_INTERVAL || just_transformed) {
-        //     last_logged = global_iteration_count;
-        //     std::vector<float> readback(N_PRINT * 4);
-        //     // Ensure the SSBO (VBO) is bound to GL_SHADER_STORAGE_BUFFER
-        //     glBindBuffer(GL_SHADER_STORAGE_BUFFER, VBO);
-        //     // Read the first N_PRINT vec4s
-        //     glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(float) * (N_PRINT * 4), readback.data());
-        //     std::cout << "GPU positions (first " << N_PRINT << ") at seed " << global_iteration_count << ":\n";
-        //     for (int p = 0; p < N_PRINT; ++p) {
-        //         float x = readback[p * 4 + 0];
-        //         float y = readback[p * 4 + 1];
-        //         float z = readback[p * 4 + 2];
-        //         float w = readback[p * 4 + 3];
-        //         std::cout << "  [" << p << "] = (" << x << ", " << y << ", " << z << ", " << w << ")\n";
-        //     }
-        // }
-
-        //glBindBuffer(GL_ARRAY_BUFFER, VBO); 
-        //glBufferData(GL_ARRAY_BUFFER, sizeof(float) * number_of_vertices, vertices, GL_DYNAMIC_DRAW);
-        
-    }
-    // shader.use();
-    // glBindVertexArray(VAO);
-    // glDrawArrays(GL_POINTS, 0, number_of_points);
+// the histogram, its texture and max_hits are all reset together; every change of the
+// fractal passes through here, so it also refreshes the box of the 16-bit point storage
+void reset_accumulation(){
+    accumulation_dirty = true;
+    point_bounds_dirty = true;
 }
 
-void compute_bransley_shader(float *vertices,ComputeShader &computeShader){
-    static int global_iteration_count = 0;
+void clear_density(unsigned int texture, unsigned int stats){
+    const GLuint zero = 0;
+    glClearTexImage(texture, 0, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+    glClearNamedBufferData(stats, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+}
 
-    computeShader.use();
-    GLint transform_array_location = glGetUniformLocation(computeShader.ID, "u_transformations[0]");
-    if(transform_array_location == -1){
-        std::cout << "Warning: uniform 'u_transformations[0]' not found (location = -1)." << std::endl;
-    } else {
-        glUniformMatrix4fv(transform_array_location, 4, GL_TRUE, glm::value_ptr(bransley_transform[0]));
-    }
-    for(int i = 0; i < iterations; i++){
-        global_iteration_count++;
-        computeShader.setInt("u_seed", global_iteration_count);
-
-        glDispatchCompute(number_of_points, 1, 1);
-    // Ensure writes to the SSBO are visible to subsequent vertex attribute fetches.
-    // When a buffer written by a shader is then used as a vertex attrib source,
-    // GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT must be included.
-        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
-    }
+// Compacts the points of `source` (from byte `offset` on, in the current point format) that
+// lie inside the view frustum into `visible` and writes their count into the
+// glDrawArraysIndirect `command`, see cull.comp. The camera has to be in uniform buffer
+// binding 0.
+void cull_with_shader(ComputeShader &cullShader, unsigned int source, std::size_t offset, unsigned int point_bytes, unsigned int visible, unsigned int command, const glm::mat4 &model){
+    const GLuint reset[4] = { 0, 1, 0, 0 };
+    glNamedBufferSubData(command, 0, sizeof(reset), reset);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 3, source, offset, (GLsizeiptr)point_bytes * number_of_points);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, visible);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, command);
+    cullShader.use();
+    cullShader.setMat4("u_model", model);
+    cullShader.setVec4("u_bounds", point_bounds);
+    glUniform1ui(cullShader.location("u_point_count"), number_of_points);
+    dispatch_points(cullShader, number_of_points);
+    // the draw reads the results; the next pass overwrites the command the atomics wrote
+    // with glNamedBufferSubData
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
 }
 
-void generate_points(float *vertices){
-    for(unsigned int i = 0; i < number_of_vertices; i+=4){
-        float V_x = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
-        float V_y = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
-        //float V_z = low + static_cast <float> (rand()) /( static_cast <float> (RAND_MAX/(high - low)));
-        vertices[i] = V_x;
-        vertices[i + 1] = V_y;
-        vertices[i + 2] = 0.0f;
-        vertices[i + 3] = 1.0f;
-    }
-}
\ No newline at end of file
+void upload_density(unsigned int texture, unsigned int stats){
+    glTextureSubImage2D(texture, 0, 0, 0, histogram.width(), histogram.height(), GL_RED_INTEGER, GL_UNSIGNED_INT, histogram.bins());
+    GLuint max_hits = histogram.max_hits();
+    glNamedBufferSubData(stats, 0, sizeof(max_hits), &max_hits);
+}
@@ -0,0 +1,25 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// hit counts per pixel, see DensityHistogram.h
+uniform usampler2D u_density;
+layout(std430, binding = 1) readonly buffer density_stats{
+    uint max_hits;
+};
+
+uniform vec4 color;
+uniform vec3 background;
+uniform float gamma;
+uniform float brightness;
+
+void main()
+{
+    uint hits = texelFetch(u_density, ivec2(TexCoords * vec2(textureSize(u_density, 0))), 0).r;
+    // DensityHistogram::intensity(): log density relative to the densest pixel, gamma corrected
+    float alpha = 0.0;
+    if(hits > 0u && max_hits > 0u)
+        alpha = min(1.0, brightness * pow(log(1.0 + float(hits)) / log(1.0 + float(max_hits)), 1.0 / gamma));
+    FragColor = vec4(mix(background, color.rgb, alpha * color.a), 1.0);
+}
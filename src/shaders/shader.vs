@@ -1,12 +1,18 @@
-#version 330 core
+#version 430 core
 layout (location = 0) in vec4 aPos;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// maps the fetched x/y out of the 16-bit point storage, (0, 0, 1, 1) for float points
+uniform vec4 bounds;
+// uploaded once per frame for all programs
+layout (std140, binding = 0) uniform Camera
+{
+    mat4 projection;
+    mat4 view;
+};
 
 void main()
 {
-    gl_Position = projection * view * model * aPos;
+    gl_Position = projection * view * model * vec4(mix(bounds.xy, bounds.zw, aPos.xy), aPos.zw);
     gl_PointSize = 0.5; // Set point size, or use a uniform for control
 }
\ No newline at end of file
@@ -0,0 +1,466 @@
+// Microbenchmark of the chaos-game kernels. Runs every selected backend on every preset over
+// a matrix of point and iteration counts, with warm-up runs and repeated measurements, and
+// reports throughput, time per point-iteration and modelled memory traffic as a table, CSV or
+// JSON, so results can be kept and compared between versions.
+//
+//   akceleracja_benchmark --backends scalar,simd,simd-threaded --points 65536,2000000 --format csv -o bench.csv
+//
+// Backends (gpu only when built with EGL):
+//   scalar          iterate_blocked() with the scalar kernel, one thread
+//   avx2, avx512    the same with one instruction set, skipped when the CPU lacks it
+//   simd            the widest instruction set the CPU supports
+//   simd-unfused    simd without cache blocking, every iteration streams the whole arrays
+//   threaded        scalar kernel on the thread pool
+//   simd-threaded   simd on the thread pool
+//   gpu             shaders/shader.comp through compute_ifs_shader(), one dispatch per run
+//
+// bytes/point is the DRAM traffic the kernel's access pattern implies per point-iteration
+// (each pass over the points reads and writes every coordinate once), not a measurement.
+//
+// --counters adds hardware counters of the CPU backends (Linux perf_event_open, see
+// PerfCounters.h), summed over every pool thread and the measured runs: IPC, last level
+// cache misses per point-iteration and the branch mispredict rate, to tell a memory bound
+// kernel from one bound by the RNG and map selection. Counters the machine does not offer
+// are left empty.
+
+#include <IFS.h>
+#include <PointStore.h>
+#include <ThreadPool.h>
+#include <PerfCounters.h>
+
+#ifdef ACCELERATION_EGL
+#include <HeadlessContext.h>
+#include <ComputeShader.h>
+#include <ComputeIFS.h>
+#include <WorkgroupTuner.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Settings
+{
+    std::vector<std::string> fractals = { "sierpinski", "barnsley", "tetrahedron", "random-scaling", "random" };
+    std::vector<std::string> backends = { "scalar", "simd", "simd-unfused", "simd-threaded" };
+    std::vector<unsigned int> points = { 16384, 262144, 2000000 };
+    std::vector<unsigned int> iterations = { 1, 10 };
+    unsigned int warmup = 1;
+    unsigned int repetitions = 5;
+    unsigned int threads = 0;
+    uint32_t seed = 1;
+    bool counters = false;
+    std::string format = "table";
+    std::string output;
+};
+
+void print_usage(const char *name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --fractals LIST     comma separated presets (default sierpinski,barnsley,tetrahedron,random-scaling,random)\n"
+              << "  --backends LIST     scalar, avx2, avx512, simd, simd-unfused, threaded, simd-threaded, gpu\n"
+              << "                      (default scalar,simd,simd-unfused,simd-threaded)\n"
+              << "  --points LIST       point counts (default 16384,262144,2000000)\n"
+              << "  --iterations LIST   iterations per run (default 1,10)\n"
+              << "  --warmup N          unmeasured runs before the measurements (default 1)\n"
+              << "  --repetitions N     measured runs (default 5)\n"
+              << "  --threads N         pool size for the threaded backends (default: all cores)\n"
+              << "  --seed N            RNG seed (default 1)\n"
+              << "  --counters          collect hardware counters of the CPU backends (Linux)\n"
+              << "  --format NAME       table, csv or json (default table)\n"
+              << "  -o, --output FILE   write the results to FILE instead of stdout\n";
+}
+
+std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while(std::getline(stream, item, ',')) if(!item.empty()) items.push_back(item);
+    return items;
+}
+
+bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto parse_unsigned = [](const std::string &text, unsigned int &value){
+            char *end;
+            unsigned long parsed = std::strtoul(text.c_str(), &end, 10);
+            value = static_cast<unsigned int>(parsed);
+            return !text.empty() && *end == '\0';
+        };
+        auto next = [&](unsigned int &value){
+            if(i + 1 >= argc) return false;
+            return parse_unsigned(argv[++i], value);
+        };
+        auto next_string = [&](std::string &value){
+            if(i + 1 >= argc) return false;
+            value = argv[++i];
+            return true;
+        };
+        auto next_list = [&](std::vector<std::string> &values){
+            if(i + 1 >= argc) return false;
+            values = split(argv[++i]);
+            return !values.empty();
+        };
+        auto next_numbers = [&](std::vector<unsigned int> &values){
+            std::vector<std::string> items;
+            if(!next_list(items)) return false;
+            values.assign(items.size(), 0);
+            for(std::size_t k = 0; k < items.size(); k++) if(!parse_unsigned(items[k], values[k]) || values[k] == 0) return false;
+            return true;
+        };
+        bool ok = true;
+        if(arg == "--fractals") ok = next_list(settings.fractals);
+        else if(arg == "--backends") ok = next_list(settings.backends);
+        else if(arg == "--points") ok = next_numbers(settings.points);
+        else if(arg == "--iterations") ok = next_numbers(settings.iterations);
+        else if(arg == "--warmup") ok = next(settings.warmup);
+        else if(arg == "--repetitions") ok = next(settings.repetitions) && settings.repetitions > 0;
+        else if(arg == "--threads") ok = next(settings.threads);
+        else if(arg == "--seed") ok = next(settings.seed);
+        else if(arg == "--counters") settings.counters = true;
+        else if(arg == "--format") ok = next_string(settings.format) && (settings.format == "table" || settings.format == "csv" || settings.format == "json");
+        else if(arg == "-o" || arg == "--output") ok = next_string(settings.output);
+        else ok = false;
+        if(!ok){
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Result
+{
+    std::string fractal;
+    std::string backend;
+    unsigned int points;
+    unsigned int iterations;
+    // seconds per run
+    double min, median, mean, stddev, max;
+    double points_per_second;
+    double ns_per_point;
+    double bytes_per_point;
+    // sums over all measured runs, only with --counters on CPU backends
+    bool has_counters = false;
+    PerfCounters::Values counters;
+};
+
+// ratio of two counters, NaN when either is missing
+double counter_ratio(const Result &r, PerfCounters::Counter numerator, PerfCounters::Counter denominator)
+{
+    if(!r.has_counters || !r.counters.valid[numerator] || !r.counters.valid[denominator] || r.counters.value[denominator] <= 0.0) return NAN;
+    return r.counters.value[numerator] / r.counters.value[denominator];
+}
+
+// counter per point-iteration, NaN when missing
+double counter_per_point(const Result &r, PerfCounters::Counter counter, unsigned int repetitions)
+{
+    if(!r.has_counters || !r.counters.valid[counter]) return NAN;
+    return r.counters.value[counter] / ((double)r.points * r.iterations * repetitions);
+}
+
+// one configured backend: runs `iterations` steps over all points of the store once
+struct Backend
+{
+    std::string name;
+    // modelled bytes per point-iteration for a 2D/3D store, see the header comment
+    std::function<double(unsigned int dimensions, unsigned int iterations)> traffic;
+    std::function<void(const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed)> run;
+    // called once per store before its runs, the GPU uploads the points there
+    std::function<void(const PointStore &points)> prepare;
+    // hardware counters only describe CPU backends, the GPU's work happens elsewhere
+    bool cpu = true;
+};
+
+// one counter set per pool thread, indexed by worker
+using CounterSets = std::vector<std::unique_ptr<PerfCounters>>;
+
+Result measure(const Settings &settings, const Backend &backend, const IFS &fractal, PointStore &points, unsigned int iterations, CounterSets *counters)
+{
+    if(!backend.cpu) counters = nullptr;
+    PerfCounters::Values totals;
+    for(bool &valid : totals.valid) valid = true;
+    if(backend.prepare) backend.prepare(points);
+    uint32_t seed = settings.seed;
+    for(unsigned int w = 0; w < settings.warmup; w++) backend.run(fractal, points, iterations, seed++);
+    std::vector<double> seconds;
+    for(unsigned int r = 0; r < settings.repetitions; r++){
+        if(counters) for(auto &set : *counters) set->start();
+        auto start = std::chrono::steady_clock::now();
+        backend.run(fractal, points, iterations, seed++);
+        seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        if(counters){
+            for(auto &set : *counters){
+                set->stop();
+                totals += set->read();
+            }
+        }
+    }
+    std::sort(seconds.begin(), seconds.end());
+
+    Result result;
+    result.fractal = fractal.name;
+    result.backend = backend.name;
+    result.points = points.size();
+    result.iterations = iterations;
+    result.min = seconds.front();
+    result.max = seconds.back();
+    std::size_t n = seconds.size();
+    result.median = n % 2 ? seconds[n / 2] : (seconds[n / 2 - 1] + seconds[n / 2]) / 2;
+    double sum = 0.0, squares = 0.0;
+    for(double s : seconds) sum += s;
+    result.mean = sum / n;
+    for(double s : seconds) squares += (s - result.mean) * (s - result.mean);
+    result.stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+    double point_iterations = (double)points.size() * iterations;
+    result.points_per_second = point_iterations / result.median;
+    result.ns_per_point = result.median * 1e9 / point_iterations;
+    result.bytes_per_point = backend.traffic(fractal.dimensions, iterations);
+    result.has_counters = counters != nullptr;
+    result.counters = totals;
+    return result;
+}
+
+// a derived counter for the output, `missing` when it was not collected
+std::string format_counter(double value, const char *format, const char *missing)
+{
+    if(std::isnan(value)) return missing;
+    char text[32];
+    std::snprintf(text, sizeof(text), format, value);
+    return text;
+}
+
+void write_results(std::ostream &out, const Settings &settings, const std::vector<Result> &results, const std::string &device)
+{
+    // IPC, LLC misses per point-iteration, branch mispredict rate and instructions per point-iteration
+    auto derived = [&](const Result &r){
+        return std::array<double, 4>{ counter_ratio(r, PerfCounters::INSTRUCTIONS, PerfCounters::CYCLES),
+                                      counter_per_point(r, PerfCounters::LLC_MISSES, settings.repetitions),
+                                      counter_ratio(r, PerfCounters::BRANCH_MISSES, PerfCounters::BRANCHES),
+                                      counter_per_point(r, PerfCounters::INSTRUCTIONS, settings.repetitions) };
+    };
+    if(settings.format == "csv"){
+        // the counter columns are always there and empty without --counters
+        out << "fractal,backend,points,iterations,min_s,median_s,mean_s,stddev_s,max_s,points_per_s,ns_per_point,bytes_per_point,"
+               "ipc,llc_misses_per_point,branch_miss_rate,instructions_per_point\n";
+        for(const Result &r : results){
+            char line[512];
+            std::snprintf(line, sizeof(line), "%s,%s,%u,%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.6g,%.6g,%.4g", r.fractal.c_str(), r.backend.c_str(), r.points, r.iterations,
+                          r.min, r.median, r.mean, r.stddev, r.max, r.points_per_second, r.ns_per_point, r.bytes_per_point);
+            out << line;
+            for(double value : derived(r)) out << "," << format_counter(value, "%.6g", "");
+            out << "\n";
+        }
+    } else if(settings.format == "json"){
+        out << "{\n  \"device\": \"" << device << "\",\n  \"warmup\": " << settings.warmup << ",\n  \"repetitions\": " << settings.repetitions << ",\n  \"results\": [\n";
+        for(std::size_t k = 0; k < results.size(); k++){
+            const Result &r = results[k];
+            char line[640];
+            std::snprintf(line, sizeof(line), "    { \"fractal\": \"%s\", \"backend\": \"%s\", \"points\": %u, \"iterations\": %u, \"min_s\": %.9g, \"median_s\": %.9g, \"mean_s\": %.9g, "
+                          "\"stddev_s\": %.9g, \"max_s\": %.9g, \"points_per_s\": %.6g, \"ns_per_point\": %.6g, \"bytes_per_point\": %.4g",
+                          r.fractal.c_str(), r.backend.c_str(), r.points, r.iterations, r.min, r.median, r.mean, r.stddev, r.max,
+                          r.points_per_second, r.ns_per_point, r.bytes_per_point);
+            out << line;
+            if(settings.counters){
+                std::array<double, 4> values = derived(r);
+                const char *names[] = { "ipc", "llc_misses_per_point", "branch_miss_rate", "instructions_per_point" };
+                for(int v = 0; v < 4; v++) out << ", \"" << names[v] << "\": " << format_counter(values[v], "%.6g", "null");
+            }
+            out << " }" << (k + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    } else {
+        out << device << ", " << settings.warmup << " warm-up + " << settings.repetitions << " measured runs, median\n";
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-24s %-14s %10s %5s %12s %10s %8s %9s", "fractal", "backend", "points", "iter", "Mpoints/s", "ns/point", "+-%", "B/point");
+        out << line;
+        if(settings.counters){
+            std::snprintf(line, sizeof(line), " %6s %9s %8s", "IPC", "LLC/pt", "br-miss%");
+            out << line;
+        }
+        out << "\n";
+        for(const Result &r : results){
+            std::snprintf(line, sizeof(line), "%-24s %-14s %10u %5u %12.1f %10.3f %8.1f %9.2f", r.fractal.c_str(), r.backend.c_str(), r.points, r.iterations,
+                          r.points_per_second / 1e6, r.ns_per_point, 100.0 * r.stddev / r.mean, r.bytes_per_point);
+            out << line;
+            if(settings.counters){
+                std::array<double, 4> values = derived(r);
+                std::snprintf(line, sizeof(line), " %6s %9s %8s", format_counter(values[0], "%.2f", "-").c_str(), format_counter(values[1], "%.4f", "-").c_str(),
+                              format_counter(100.0 * values[2], "%.2f", "-").c_str());
+                out << line;
+            }
+            out << "\n";
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(!parse_arguments(argc, argv, settings)){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 generator(settings.seed);
+    std::vector<IFS> fractals;
+    for(const std::string &name : settings.fractals){
+        IFS fractal;
+        if(!IFS::preset(name, fractal, generator)){
+            std::cout << "ERROR::ARGUMENTS: unknown fractal " << name << std::endl;
+            return 1;
+        }
+        fractals.push_back(fractal);
+    }
+
+    ThreadPool pool(settings.threads);
+    IterationOptions fused, unfused;
+    unfused.fused = false;
+    SimdLevel best = simd_level();
+    // a CPU pass reads and writes every coordinate once; fused backends pass once per run
+    auto cpu_traffic = [](bool once_per_run){
+        return [once_per_run](unsigned int dimensions, unsigned int iterations){
+            double pass = 2.0 * dimensions * sizeof(float);
+            return once_per_run ? pass / iterations : pass;
+        };
+    };
+    auto single = [](SimdLevel level, const IterationOptions &options){
+        return [level, options](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+            iterate_blocked(fractal.table(), points, 0, points.size(), iterations, seed, options, level);
+        };
+    };
+    auto threaded = [&pool](SimdLevel level, const IterationOptions &options){
+        return [&pool, level, options](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+            pool.parallel_for(0, points.size(), PointStore::PADDING, [&](unsigned int begin, unsigned int end, unsigned int){
+                iterate_blocked(fractal.table(), points, begin, end, iterations, seed, options, level);
+            });
+        };
+    };
+
+#ifdef ACCELERATION_EGL
+    std::unique_ptr<HeadlessContext> context;
+    std::unique_ptr<ComputeShader> computeShader;
+    unsigned int SSBO = 0;
+#endif
+    std::vector<Backend> backends;
+    for(const std::string &name : settings.backends){
+        if(name == "scalar") backends.push_back({ name, cpu_traffic(true), single(SimdLevel::Scalar, fused), nullptr });
+        else if(name == "avx2" || name == "avx512"){
+            SimdLevel level = name == "avx2" ? SimdLevel::AVX2 : SimdLevel::AVX512;
+            if(static_cast<int>(best) < static_cast<int>(level)){
+                std::cout << "Warning: the CPU does not support " << simd_level_name(level) << ", skipping " << name << std::endl;
+                continue;
+            }
+            backends.push_back({ name, cpu_traffic(true), single(level, fused), nullptr });
+        }
+        else if(name == "simd") backends.push_back({ name, cpu_traffic(true), single(best, fused), nullptr });
+        else if(name == "simd-unfused") backends.push_back({ name, cpu_traffic(false), single(best, unfused), nullptr });
+        else if(name == "threaded") backends.push_back({ name, cpu_traffic(true), threaded(SimdLevel::Scalar, fused), nullptr });
+        else if(name == "simd-threaded") backends.push_back({ name, cpu_traffic(true), threaded(best, fused), nullptr });
+        else if(name == "gpu"){
+#ifdef ACCELERATION_EGL
+            context = std::make_unique<HeadlessContext>();
+            if(!context->valid) return 1;
+            glCreateBuffers(1, &SSBO);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, SSBO);
+            WorkgroupTuner tuner("shaders/shader.comp");
+            unsigned int local_size = tuner.cached();
+            computeShader = std::make_unique<ComputeShader>("shaders/shader.comp", WorkgroupTuner::defines(local_size ? local_size : WorkgroupTuner::DEFAULT_SIZE));
+            Backend gpu;
+            gpu.name = name;
+            // vec4 positions read and written once per single-pass dispatch
+            gpu.traffic = [](unsigned int, unsigned int iterations){ return 2.0 * 4 * sizeof(float) / iterations; };
+            gpu.prepare = [&](const PointStore &points){
+                std::vector<float> vertices(4 * (std::size_t)points.size());
+                points.pack_vec4(vertices.data());
+                glNamedBufferData(SSBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_COPY);
+            };
+            gpu.run = [&](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+                int gpu_seed = static_cast<int>(seed);
+                compute_ifs_shader(*computeShader, fractal, points.size(), iterations, gpu_seed);
+                // the dispatch is asynchronous, the run ends when the GPU is done
+                glFinish();
+            };
+            gpu.cpu = false;
+            backends.push_back(gpu);
+#else
+            std::cout << "ERROR::ARGUMENTS: built without EGL, the gpu backend is unavailable" << std::endl;
+            return 1;
+#endif
+        }
+        else {
+            std::cout << "ERROR::ARGUMENTS: unknown backend " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::string device = std::string("CPU ") + simd_level_name(best) + ", " + std::to_string(pool.size()) + " threads";
+
+    // every pool thread opens the counters of its own thread, one chunk per worker
+    CounterSets counters;
+    if(settings.counters){
+        counters.resize(pool.size());
+        pool.parallel_for(0, pool.size(), 1, [&](unsigned int, unsigned int, unsigned int worker){
+            counters[worker] = std::make_unique<PerfCounters>();
+        });
+        bool available = std::all_of(counters.begin(), counters.end(), [](const auto &set){ return set->available(); });
+        if(!available){
+            std::cout << "Warning: hardware counters are unavailable (no PMU, or see /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+            counters.clear();
+        }
+    }
+#ifdef ACCELERATION_EGL
+    if(context) device += ", GPU " + std::string(context->renderer()) + " local_size_x " + std::to_string(computeShader->invocations());
+#endif
+
+    std::vector<Result> results;
+    for(const IFS &fractal : fractals){
+        for(unsigned int count : settings.points){
+            PointStore points(count, fractal.dimensions);
+            srand(settings.seed);
+            points.generate(0.0f, 1.0f);
+            for(const Backend &backend : backends){
+                for(unsigned int iterations : settings.iterations){
+                    results.push_back(measure(settings, backend, fractal, points, iterations, counters.empty() ? nullptr : &counters));
+                    // progress on stderr, the results may be going to stdout
+                    const Result &r = results.back();
+                    std::fprintf(stderr, "%s %s %u x %u: %.1f Mpoints/s\n", r.fractal.c_str(), r.backend.c_str(), r.points, r.iterations, r.points_per_second / 1e6);
+                }
+            }
+        }
+    }
+
+    if(settings.output.empty()){
+        write_results(std::cout, settings, results, device);
+        return 0;
+    }
+    std::ofstream file(settings.output);
+    if(!file){
+        std::cout << "ERROR::BENCHMARK::FILE_NOT_WRITABLE: " << settings.output << std::endl;
+        return 1;
+    }
+    write_results(file, settings, results, device);
+    return 0;
+}
@@ -0,0 +1,331 @@
+// Statistical equivalence of the backends. Every backend runs the same IFS from the same start
+// points, the x/y of its points after every frame are binned into a density histogram over
+// IFS::bounds(), and the histogram is compared with the scalar single-thread reference by the
+// total variation distance (half the L1 distance of the normalised histograms, 0 = identical,
+// 1 = disjoint). The Jensen-Shannon divergence is printed alongside.
+//
+// By default every backend draws its own random streams, as a future kernel with another RNG
+// order would, so even a correct backend is only statistically equal. The noise floor comes
+// from the scalar reference re-run with yet another seed, and a backend fails when its
+// distance exceeds that floor by more than the tolerance. With --same-seed all backends use
+// the reference's streams, which the current kernels reproduce up to rounding, and any
+// distance above --threshold fails.
+//
+// Exits with 1 and prints ERROR::EQUIVALENCE::DIVERGED when any backend fails.
+//
+//   akceleracja_equivalence --fractals barnsley,random --backends simd,simd-threaded,gpu
+//
+// The gpu backends need EGL (ACCELERATION_EGL) and run on software GL as well.
+
+#include <IFS.h>
+#include <PointStore.h>
+#include <ThreadPool.h>
+
+#ifdef ACCELERATION_EGL
+#include <HeadlessContext.h>
+#include <ComputeShader.h>
+#include <ComputeIFS.h>
+#include <PointFormat.h>
+#include <WorkgroupTuner.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+struct Settings
+{
+    std::vector<std::string> fractals = { "sierpinski", "barnsley", "tetrahedron", "random-scaling", "random" };
+    std::vector<std::string> backends = { "simd", "simd-unfused", "threaded", "simd-threaded" };
+    unsigned int points = 1 << 20;
+    unsigned int iterations = 10;
+    unsigned int frames = 8;
+    unsigned int bins = 256;
+    unsigned int threads = 0;
+    uint32_t seed = 1;
+    bool same_seed = false;
+    double tolerance = 1.25;
+    double threshold = 0.002;
+};
+
+void print_usage(const char *name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --fractals LIST     comma separated presets (default sierpinski,barnsley,tetrahedron,random-scaling,random)\n"
+              << "  --backends LIST     simd, avx2, avx512, simd-unfused, threaded, simd-threaded, gpu, gpu-vec2, gpu-unorm16\n"
+              << "                      (default simd,simd-unfused,threaded,simd-threaded)\n"
+              << "  --points N          points per run (default 1048576)\n"
+              << "  --iterations N      iterations per frame (default 10)\n"
+              << "  --frames N          frames binned (default 8)\n"
+              << "  --bins N            histogram resolution per axis (default 256)\n"
+              << "  --threads N         pool size for the threaded backends (default: all cores)\n"
+              << "  --seed N            RNG seed (default 1)\n"
+              << "  --same-seed         all backends use the reference's random streams\n"
+              << "  --tolerance X       allowed distance as a multiple of the noise floor (default 1.25)\n"
+              << "  --threshold X       allowed distance on top of that, the whole limit with --same-seed (default 0.002)\n";
+}
+
+std::vector<std::string> split(const std::string &list)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(list);
+    std::string item;
+    while(std::getline(stream, item, ',')) if(!item.empty()) items.push_back(item);
+    return items;
+}
+
+bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto next = [&](unsigned int &value){
+            if(i + 1 >= argc) return false;
+            char *end;
+            unsigned long parsed = std::strtoul(argv[++i], &end, 10);
+            value = static_cast<unsigned int>(parsed);
+            return *end == '\0';
+        };
+        auto next_double = [&](double &value){
+            if(i + 1 >= argc) return false;
+            char *end;
+            value = std::strtod(argv[++i], &end);
+            return *end == '\0' && value >= 0.0;
+        };
+        auto next_list = [&](std::vector<std::string> &values){
+            if(i + 1 >= argc) return false;
+            values = split(argv[++i]);
+            return !values.empty();
+        };
+        bool ok = true;
+        if(arg == "--fractals") ok = next_list(settings.fractals);
+        else if(arg == "--backends") ok = next_list(settings.backends);
+        else if(arg == "--points") ok = next(settings.points) && settings.points > 0;
+        else if(arg == "--iterations") ok = next(settings.iterations) && settings.iterations > 0;
+        else if(arg == "--frames") ok = next(settings.frames) && settings.frames > 0;
+        else if(arg == "--bins") ok = next(settings.bins) && settings.bins > 0;
+        else if(arg == "--threads") ok = next(settings.threads);
+        else if(arg == "--seed") ok = next(settings.seed);
+        else if(arg == "--same-seed") settings.same_seed = true;
+        else if(arg == "--tolerance") ok = next_double(settings.tolerance);
+        else if(arg == "--threshold") ok = next_double(settings.threshold);
+        else ok = false;
+        if(!ok){
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// bins x bins counts over the box, plus one bin for everything outside it (NaN included)
+struct Histogram
+{
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+
+    Histogram(unsigned int bins) : counts((std::size_t)bins * bins + 1, 0) {}
+
+    void add(const PointStore &points, const glm::vec4 &box, unsigned int bins)
+    {
+        const float *xs = points.x(), *ys = points.y();
+        const float sx = bins / (box.z - box.x), sy = bins / (box.w - box.y);
+        const std::size_t outside = counts.size() - 1;
+        for(unsigned int i = 0; i < points.size(); i++){
+            float u = (xs[i] - box.x) * sx, v = (ys[i] - box.y) * sy;
+            // written so NaN fails the test
+            if(u >= 0.0f && u < bins && v >= 0.0f && v < bins) counts[(std::size_t)v * bins + (std::size_t)u]++;
+            else counts[outside]++;
+        }
+        total += points.size();
+    }
+};
+
+// total variation distance of the normalised histograms
+double total_variation(const Histogram &a, const Histogram &b)
+{
+    double sum = 0.0;
+    for(std::size_t k = 0; k < a.counts.size(); k++) sum += std::abs((double)a.counts[k] / a.total - (double)b.counts[k] / b.total);
+    return 0.5 * sum;
+}
+
+// Jensen-Shannon divergence in bits, between 0 and 1
+double jensen_shannon(const Histogram &a, const Histogram &b)
+{
+    double sum = 0.0;
+    for(std::size_t k = 0; k < a.counts.size(); k++){
+        double p = (double)a.counts[k] / a.total, q = (double)b.counts[k] / b.total, m = 0.5 * (p + q);
+        if(p > 0.0) sum += 0.5 * p * std::log2(p / m);
+        if(q > 0.0) sum += 0.5 * q * std::log2(q / m);
+    }
+    return sum;
+}
+
+// one way of iterating: runs `iterations` steps on all points with the frame's seed
+struct Backend
+{
+    std::string name;
+    std::function<void(const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed)> run;
+};
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(!parse_arguments(argc, argv, settings)){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 generator(settings.seed);
+    std::vector<IFS> fractals;
+    for(const std::string &name : settings.fractals){
+        IFS fractal;
+        if(!IFS::preset(name, fractal, generator)){
+            std::cout << "ERROR::ARGUMENTS: unknown fractal " << name << std::endl;
+            return 1;
+        }
+        fractals.push_back(fractal);
+    }
+
+    ThreadPool pool(settings.threads);
+    IterationOptions fused, unfused;
+    unfused.fused = false;
+    SimdLevel best = simd_level();
+    auto single = [](SimdLevel level, const IterationOptions &options){
+        return [level, options](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+            iterate_blocked(fractal.table(), points, 0, points.size(), iterations, seed, options, level);
+        };
+    };
+    auto threaded = [&pool](SimdLevel level, const IterationOptions &options){
+        return [&pool, level, options](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+            pool.parallel_for(0, points.size(), PointStore::PADDING, [&](unsigned int begin, unsigned int end, unsigned int){
+                iterate_blocked(fractal.table(), points, begin, end, iterations, seed, options, level);
+            });
+        };
+    };
+
+#ifdef ACCELERATION_EGL
+    std::unique_ptr<HeadlessContext> context;
+    unsigned int SSBO = 0, local_size = 0;
+    std::vector<char> staging;
+    // one compute shader per point format, built on first use
+    std::unique_ptr<ComputeShader> computeShaders[3];
+    auto gpu = [&](PointFormat requested){
+        return [&, requested](const IFS &fractal, PointStore &points, unsigned int iterations, uint32_t seed){
+            PointFormat format = point_format::effective(requested, fractal.dimensions);
+            std::unique_ptr<ComputeShader> &shader = computeShaders[static_cast<int>(format)];
+            if(!shader) shader = std::make_unique<ComputeShader>("shaders/shader.comp", WorkgroupTuner::defines(local_size) + point_format::defines(format));
+            glm::vec4 bounds = format == PointFormat::UNORM16 ? fractal.bounds() : glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+            shader->uniform("u_decode_bounds").set(bounds);
+            shader->uniform("u_encode_bounds").set(bounds);
+            GLsizeiptr bytes = (GLsizeiptr)point_format::bytes(format) * points.size();
+            staging.resize(bytes);
+            point_format::pack(points, format, staging.data(), bounds);
+            glNamedBufferData(SSBO, bytes, staging.data(), GL_DYNAMIC_COPY);
+            // compute_ifs_shader() advances the seed first, this hands it the CPU frame's seed
+            int gpu_seed = static_cast<int>(seed - 1);
+            compute_ifs_shader(*shader, fractal, points.size(), iterations, gpu_seed);
+            glGetNamedBufferSubData(SSBO, 0, bytes, staging.data());
+            point_format::unpack(points, format, staging.data(), bounds);
+        };
+    };
+#endif
+
+    Backend reference{ "scalar", single(SimdLevel::Scalar, fused) };
+    std::vector<Backend> backends;
+    for(const std::string &name : settings.backends){
+        if(name == "simd") backends.push_back({ name, single(best, fused) });
+        else if(name == "avx2" || name == "avx512"){
+            SimdLevel level = name == "avx2" ? SimdLevel::AVX2 : SimdLevel::AVX512;
+            if(static_cast<int>(best) < static_cast<int>(level)){
+                std::cout << "Warning: the CPU does not support " << simd_level_name(level) << ", skipping " << name << std::endl;
+                continue;
+            }
+            backends.push_back({ name, single(level, fused) });
+        }
+        else if(name == "simd-unfused") backends.push_back({ name, single(best, unfused) });
+        else if(name == "threaded") backends.push_back({ name, threaded(SimdLevel::Scalar, fused) });
+        else if(name == "simd-threaded") backends.push_back({ name, threaded(best, fused) });
+        else if(name == "gpu" || name == "gpu-vec2" || name == "gpu-unorm16"){
+#ifdef ACCELERATION_EGL
+            if(!context){
+                context = std::make_unique<HeadlessContext>();
+                if(!context->valid) return 1;
+                glCreateBuffers(1, &SSBO);
+                glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, SSBO);
+                local_size = WorkgroupTuner("shaders/shader.comp").cached();
+                if(local_size == 0) local_size = WorkgroupTuner::DEFAULT_SIZE;
+            }
+            PointFormat format = name == "gpu" ? PointFormat::VEC4 : name == "gpu-vec2" ? PointFormat::VEC2 : PointFormat::UNORM16;
+            backends.push_back({ name, gpu(format) });
+#else
+            std::cout << "ERROR::ARGUMENTS: built without EGL, the gpu backends are unavailable" << std::endl;
+            return 1;
+#endif
+        }
+        else {
+            std::cout << "ERROR::ARGUMENTS: unknown backend " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::string device = std::string("CPU ") + simd_level_name(best) + ", " + std::to_string(pool.size()) + " threads";
+#ifdef ACCELERATION_EGL
+    if(context) device += ", GPU " + std::string(context->renderer());
+#endif
+    std::printf("%s, %u points x %u iterations x %u frames, %ux%u bins, %s seeds\n", device.c_str(), settings.points, settings.iterations,
+                settings.frames, settings.bins, settings.bins, settings.same_seed ? "shared" : "independent");
+
+    // the histogram of one backend; stream decides the frames' seeds, 0 is the reference's
+    auto sample = [&](const Backend &backend, const IFS &fractal, const glm::vec4 &box, uint32_t stream){
+        srand(settings.seed);
+        PointStore points(settings.points, fractal.dimensions);
+        points.generate(0.0f, 1.0f);
+        Histogram histogram(settings.bins);
+        for(unsigned int frame = 0; frame < settings.frames; frame++){
+            uint32_t seed = rng::hash(rng::hash(settings.seed + frame) + stream);
+            backend.run(fractal, points, settings.iterations, seed);
+            histogram.add(points, box, settings.bins);
+        }
+        return histogram;
+    };
+
+    bool failed = false;
+    for(const IFS &fractal : fractals){
+        glm::vec4 box = fractal.bounds();
+        Histogram expected = sample(reference, fractal, box, 0);
+        // noise floor: the reference against itself with other streams
+        double floor = total_variation(expected, sample(reference, fractal, box, 0x9E3779B9u));
+        double limit = settings.same_seed ? settings.threshold : settings.tolerance * floor + settings.threshold;
+        std::printf("\n%s: noise floor %.5f, limit %.5f, %.2f%% of the reference outside the box\n", fractal.name.c_str(), floor, limit,
+                    100.0 * expected.counts.back() / expected.total);
+        for(std::size_t k = 0; k < backends.size(); k++){
+            uint32_t stream = settings.same_seed ? 0 : static_cast<uint32_t>(k + 1);
+            Histogram observed = sample(backends[k], fractal, box, stream);
+            double distance = total_variation(expected, observed);
+            bool pass = distance <= limit;
+            std::printf("  %-14s %s  total variation %.5f, Jensen-Shannon %.6f\n", backends[k].name.c_str(), pass ? "ok  " : "FAIL",
+                        distance, jensen_shannon(expected, observed));
+            if(!pass){
+                std::cout << "ERROR::EQUIVALENCE::DIVERGED: " << backends[k].name << " on " << fractal.name << std::endl;
+                failed = true;
+            }
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,290 @@
+// Offline renderer: runs the IFS engine from the command line, without a window, GLFW or
+// ImGui, and writes the attractor as a binary PPM image. Meant for batch jobs and render
+// nodes without a display.
+//
+//   akceleracja_headless --fractal barnsley --points 4000000 --frames 20 -o fern.ppm
+//
+// The GPU backend is only available when the tool was built with EGL (ACCELERATION_EGL).
+
+#include <IFS.h>
+#include <PointStore.h>
+#include <ThreadPool.h>
+#include <DensityHistogram.h>
+
+#ifdef ACCELERATION_EGL
+#include <HeadlessContext.h>
+#include <ComputeShader.h>
+#include <ComputeIFS.h>
+#include <PointFormat.h>
+#include <WorkgroupTuner.h>
+#endif
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Settings
+{
+    std::string fractal = "sierpinski";
+    std::string transforms;
+    std::string backend = "simd";
+    std::string output = "fractal.ppm";
+    unsigned int points = 2000000;
+    unsigned int iterations = 10;
+    unsigned int frames = 10;
+    unsigned int width = 1920;
+    unsigned int height = 1080;
+    unsigned int threads = 0;
+    uint32_t seed = 1;
+    float gamma = 2.2f;
+    unsigned int local_size = 0;
+    bool single_pass = true;
+    std::string format = "vec4";
+};
+
+void print_usage(const char *name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --fractal NAME      sierpinski, barnsley, tetrahedron, random-scaling, random (default sierpinski)\n"
+              << "  --transforms FILE   read the maps from FILE instead, see IFS::load()\n"
+              << "  --backend NAME      cpu, threaded, simd, simd-threaded, gpu (default simd)\n"
+              << "  --points N          number of points (default 2000000)\n"
+              << "  --iterations N      iterations per frame (default 10)\n"
+              << "  --frames N          frames, each one adds every point to the image (default 10)\n"
+              << "  --width N --height N  image resolution (default 1920x1080)\n"
+              << "  --threads N         worker threads for the threaded backends (default: all cores)\n"
+              << "  --seed N            RNG seed (default 1)\n"
+              << "  --gamma G           tone mapping gamma (default 2.2)\n"
+              << "  --local-size N      compute shader work group size (default: tuned, cached per device)\n"
+              << "  --per-iteration     gpu: one dispatch per iteration instead of looping in the shader\n"
+              << "  --format NAME       gpu: point storage vec4, vec2 or unorm16, 2D fractals only (default vec4)\n"
+              << "  -o, --output FILE   output image, binary PPM (default fractal.ppm)\n";
+}
+
+bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto next = [&](unsigned int &value){
+            if(i + 1 >= argc) return false;
+            char *end;
+            unsigned long parsed = std::strtoul(argv[++i], &end, 10);
+            value = static_cast<unsigned int>(parsed);
+            return *end == '\0';
+        };
+        auto next_string = [&](std::string &value){
+            if(i + 1 >= argc) return false;
+            value = argv[++i];
+            return true;
+        };
+        bool ok = true;
+        if(arg == "--fractal") ok = next_string(settings.fractal);
+        else if(arg == "--transforms") ok = next_string(settings.transforms);
+        else if(arg == "--backend") ok = next_string(settings.backend);
+        else if(arg == "--points") ok = next(settings.points);
+        else if(arg == "--iterations") ok = next(settings.iterations);
+        else if(arg == "--frames") ok = next(settings.frames);
+        else if(arg == "--width") ok = next(settings.width);
+        else if(arg == "--height") ok = next(settings.height);
+        else if(arg == "--threads") ok = next(settings.threads);
+        else if(arg == "--seed") ok = next(settings.seed);
+        else if(arg == "--local-size") ok = next(settings.local_size);
+        else if(arg == "--per-iteration") settings.single_pass = false;
+        else if(arg == "--format") ok = next_string(settings.format);
+        else if(arg == "--gamma"){
+            std::string value;
+            ok = next_string(value);
+            if(ok){
+                char *end;
+                settings.gamma = std::strtof(value.c_str(), &end);
+                ok = *end == '\0' && settings.gamma > 0.0f;
+            }
+        }
+        else if(arg == "-o" || arg == "--output") ok = next_string(settings.output);
+        else ok = false;
+        if(!ok){
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return settings.points > 0 && settings.width > 0 && settings.height > 0;
+}
+
+// orthographic view of the bounding box of the points, fitted to the image with a 5% margin
+glm::mat4 fit_view(const PointStore &points, unsigned int width, unsigned int height)
+{
+    float min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    for(unsigned int i = 0; i < points.size(); i++){
+        float x = points.x()[i], y = points.y()[i];
+        if(!std::isfinite(x) || !std::isfinite(y)) continue;
+        min_x = std::min(min_x, x); max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y); max_y = std::max(max_y, y);
+    }
+    if(!(max_x >= min_x)){ min_x = min_y = -1.0f; max_x = max_y = 1.0f; }
+    // same scale on both axes, centered
+    float extent = std::max((max_x - min_x) / width, (max_y - min_y) / height) * 1.05f;
+    if(!(extent > 0.0f)) extent = 1.0f / std::max(width, height);
+    float center_x = (min_x + max_x) / 2, center_y = (min_y + max_y) / 2;
+    float half_w = extent * width / 2, half_h = extent * height / 2;
+    return glm::ortho(center_x - half_w, center_x + half_w, center_y - half_h, center_y + half_h);
+}
+
+// tone-mapped with DensityHistogram::intensity() from the application's background color
+// to its point color, top row first
+bool write_ppm(const DensityHistogram &histogram, const std::string &path, float gamma)
+{
+    std::ofstream file(path, std::ios::binary);
+    if(!file){
+        std::cout << "ERROR::IMAGE::FILE_NOT_WRITABLE: " << path << std::endl;
+        return false;
+    }
+    const float color[3] = { 114.0f / 255.0f, 144.0f / 255.0f, 154.0f / 255.0f };
+    unsigned int width = histogram.width(), height = histogram.height();
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row(width * 3);
+    for(unsigned int y = height; y-- > 0;){
+        for(unsigned int x = 0; x < width; x++){
+            float alpha = DensityHistogram::intensity(histogram.hits(x, y), histogram.max_hits(), gamma);
+            for(int c = 0; c < 3; c++){
+                float background = color[c] / 2.0f;
+                row[x * 3 + c] = static_cast<unsigned char>(255.0f * (background + (color[c] - background) * alpha) + 0.5f);
+            }
+        }
+        file.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return bool(file);
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(!parse_arguments(argc, argv, settings)){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 generator(settings.seed);
+    IFS fractal;
+    if(!settings.transforms.empty()){
+        if(!IFS::load(settings.transforms, fractal)) return 1;
+    } else if(!IFS::preset(settings.fractal, fractal, generator)){
+        std::cout << "ERROR::ARGUMENTS: unknown fractal " << settings.fractal << std::endl;
+        return 1;
+    }
+
+    srand(settings.seed);
+    PointStore points(settings.points, fractal.dimensions);
+    points.generate(0.0f, 1.0f);
+    DensityHistogram histogram(settings.width, settings.height);
+    glm::mat4 view(1.0f);
+
+    const bool gpu = settings.backend == "gpu";
+    const bool threaded = settings.backend == "threaded" || settings.backend == "simd-threaded";
+    SimdLevel level = settings.backend == "cpu" || settings.backend == "threaded" ? SimdLevel::Scalar : simd_level();
+    if(!gpu && settings.backend != "cpu" && settings.backend != "simd" && !threaded){
+        std::cout << "ERROR::ARGUMENTS: unknown backend " << settings.backend << std::endl;
+        return 1;
+    }
+    ThreadPool pool(threaded ? settings.threads : 1);
+    IterationOptions options;
+
+#ifdef ACCELERATION_EGL
+    std::unique_ptr<HeadlessContext> context;
+    std::unique_ptr<ComputeShader> computeShader;
+    unsigned int SSBO = 0;
+    std::vector<float> vertices;
+    PointFormat format = PointFormat::VEC4;
+    glm::vec4 bounds(0.0f, 0.0f, 1.0f, 1.0f);
+    if(gpu){
+        if(!point_format::parse(settings.format, format)){
+            std::cout << "ERROR::ARGUMENTS: unknown point format " << settings.format << std::endl;
+            return 1;
+        }
+        format = point_format::effective(format, fractal.dimensions);
+        context = std::make_unique<HeadlessContext>();
+        if(!context->valid) return 1;
+        // vec4 for the tuner, the render switches to the chosen format afterwards
+        vertices.resize(4 * (size_t)settings.points);
+        points.pack_vec4(vertices.data());
+        glCreateBuffers(1, &SSBO);
+        glNamedBufferData(SSBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_COPY);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, SSBO);
+        WorkgroupTuner tuner("shaders/shader.comp");
+        unsigned int local_size = settings.local_size ? settings.local_size : tuner.cached();
+        if(local_size == 0) local_size = tuner.tune(fractal, std::min(settings.points, WorkgroupTuner::SAMPLE_POINTS));
+        // the benchmark iterated the points, start the render from the generated ones again
+        if(format == PointFormat::UNORM16) bounds = fractal.bounds();
+        point_format::pack(points, format, vertices.data(), bounds);
+        glNamedBufferData(SSBO, (GLsizeiptr)point_format::bytes(format) * settings.points, vertices.data(), GL_DYNAMIC_COPY);
+        computeShader = std::make_unique<ComputeShader>("shaders/shader.comp", WorkgroupTuner::defines(local_size) + point_format::defines(format));
+        computeShader->uniform("u_decode_bounds").set(bounds);
+        computeShader->uniform("u_encode_bounds").set(bounds);
+    }
+#else
+    if(gpu){
+        std::cout << "ERROR::ARGUMENTS: built without EGL, the gpu backend is unavailable" << std::endl;
+        return 1;
+    }
+#endif
+
+    double compute_seconds = 0.0;
+    for(unsigned int frame = 0; frame < settings.frames; frame++){
+        uint32_t seed = rng::hash(settings.seed + frame);
+        auto start = std::chrono::steady_clock::now();
+        if(gpu){
+#ifdef ACCELERATION_EGL
+            // compute_ifs_shader() advances the seed first, this hands it the CPU frame's seed
+            // and the shader picks the same maps as the CPU backends
+            int gpu_seed = static_cast<int>(seed - 1);
+            compute_ifs_shader(*computeShader, fractal, settings.points, settings.iterations, gpu_seed, settings.single_pass);
+            glGetNamedBufferSubData(SSBO, 0, (GLsizeiptr)point_format::bytes(format) * settings.points, vertices.data());
+#endif
+        } else if(threaded){
+            pool.parallel_for(0, settings.points, PointStore::PADDING, [&](unsigned int begin, unsigned int end, unsigned int){
+                iterate_blocked(fractal.table(), points, begin, end, settings.iterations, seed, options, level);
+            });
+        } else {
+            iterate_blocked(fractal.table(), points, 0, settings.points, settings.iterations, seed, options, level);
+        }
+        compute_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+#ifdef ACCELERATION_EGL
+        if(gpu) point_format::unpack(points, format, vertices.data(), bounds);
+#endif
+        if(frame == 0) view = fit_view(points, settings.width, settings.height);
+        histogram.accumulate(pool, points, 0, settings.points, view);
+    }
+
+    if(!write_ppm(histogram, settings.output, settings.gamma)) return 1;
+
+    std::string device = simd_level_name(level);
+    if(threaded) device = std::to_string(pool.size()) + " threads, " + device;
+#ifdef ACCELERATION_EGL
+    if(gpu) device = std::string(context->renderer()) + ", local_size_x " + std::to_string(computeShader->invocations()) + ", " + point_format::name(format) + " points";
+#endif
+    double point_iterations = (double)settings.points * settings.iterations * settings.frames;
+    std::printf("%s, %s backend (%s), %u points x %u iterations x %u frames\n", fractal.name.c_str(), settings.backend.c_str(),
+                device.c_str(), settings.points, settings.iterations, settings.frames);
+    std::printf("compute %.3f s, %.1f Mpoint-iterations/s, %.2f ns/point-iteration\n", compute_seconds,
+                point_iterations / compute_seconds / 1e6, compute_seconds * 1e9 / point_iterations);
+    std::printf("wrote %ux%u image to %s\n", settings.width, settings.height, settings.output.c_str());
+    return 0;
+}
@@ -0,0 +1,248 @@
+// Statistical check of the compute shader's map selection. shaders/shader.comp is built with
+// RECORD_MAPS, which stores the map every point picks in every iteration, and the record is
+// compared with the CPU kernels' choices and with the distribution the alias table encodes:
+//
+//   agreement     every (iteration, point) picks the same map as simd_detail::select_map()
+//   frequencies   chi-square of the map counts against the alias table's probabilities
+//   independence  chi-square of map pairs against the product distribution, for neighbouring
+//                 points, consecutive iterations of one point and the diagonal (point i + 1
+//                 at iteration k against point i at iteration k - 1, which the old
+//                 `hash(u_seed + idx)` made identical)
+//
+// Prints one line per test and exits with 1 when any of them fails.
+//
+//   akceleracja_rng_check --fractal barnsley --points 262144 --iterations 8
+
+#include <IFS.h>
+#include <HeadlessContext.h>
+#include <ComputeShader.h>
+#include <ComputeIFS.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Settings
+{
+    std::string fractal = "barnsley";
+    std::string transforms;
+    unsigned int points = 1 << 18;
+    unsigned int iterations = 8;
+    uint32_t seed = 1;
+};
+
+void print_usage(const char *name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --fractal NAME      sierpinski, barnsley, tetrahedron, random-scaling, random (default barnsley)\n"
+              << "  --transforms FILE   read the maps from FILE instead, see IFS::load()\n"
+              << "  --points N          points per iteration (default 262144)\n"
+              << "  --iterations N      iterations recorded (default 8)\n"
+              << "  --seed N            RNG seed (default 1)\n";
+}
+
+bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto next = [&](unsigned int &value){
+            if(i + 1 >= argc) return false;
+            char *end;
+            unsigned long parsed = std::strtoul(argv[++i], &end, 10);
+            value = static_cast<unsigned int>(parsed);
+            return *end == '\0';
+        };
+        auto next_string = [&](std::string &value){
+            if(i + 1 >= argc) return false;
+            value = argv[++i];
+            return true;
+        };
+        bool ok = true;
+        if(arg == "--fractal") ok = next_string(settings.fractal);
+        else if(arg == "--transforms") ok = next_string(settings.transforms);
+        else if(arg == "--points") ok = next(settings.points);
+        else if(arg == "--iterations") ok = next(settings.iterations);
+        else if(arg == "--seed") ok = next(settings.seed);
+        else ok = false;
+        if(!ok){
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return settings.points > 1 && settings.iterations > 1;
+}
+
+// exact probability of every map under the 24 bit fixed point alias table
+std::vector<double> map_probabilities(const MapTable &table)
+{
+    std::vector<double> p(table.count, 0.0);
+    for(unsigned int column = 0; column < table.count; column++){
+        double keep = table.alias_probability[column] / 16777216.0;
+        p[column] += keep / table.count;
+        p[table.alias_index[column]] += (1.0 - keep) / table.count;
+    }
+    return p;
+}
+
+// Wilson-Hilferty approximation of the chi-square quantile with `df` degrees of freedom at
+// standard normal quantile z
+double chi_square_critical(double df, double z)
+{
+    double a = 2.0 / (9.0 * df);
+    return df * std::pow(1.0 - a + z * std::sqrt(a), 3.0);
+}
+
+// chi-square statistic of observed counts against expected probabilities, outcomes with
+// zero probability must not occur at all (they make the statistic infinite)
+double chi_square(const std::vector<uint64_t> &observed, const std::vector<double> &expected, uint64_t total, unsigned int &df)
+{
+    double statistic = 0.0;
+    df = 0;
+    for(std::size_t k = 0; k < observed.size(); k++){
+        double e = expected[k] * total;
+        if(e <= 0.0){
+            if(observed[k] > 0) return INFINITY;
+            continue;
+        }
+        statistic += (observed[k] - e) * (observed[k] - e) / e;
+        df++;
+    }
+    if(df > 0) df--;
+    return statistic;
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(!parse_arguments(argc, argv, settings)){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 generator(settings.seed);
+    IFS fractal;
+    if(!settings.transforms.empty()){
+        if(!IFS::load(settings.transforms, fractal)) return 1;
+    } else if(!IFS::preset(settings.fractal, fractal, generator)){
+        std::cout << "ERROR::ARGUMENTS: unknown fractal " << settings.fractal << std::endl;
+        return 1;
+    }
+    const MapTable &table = fractal.table();
+    const unsigned int maps = table.count;
+    const unsigned int n = settings.points, iterations = settings.iterations;
+
+    HeadlessContext context;
+    if(!context.valid) return 1;
+
+    // the positions only matter to the shader's stores, not to the map selection
+    std::vector<float> vertices(4 * (std::size_t)n, 0.0f);
+    for(unsigned int i = 0; i < n; i++) vertices[4 * i + 3] = 1.0f;
+    unsigned int SSBO, record;
+    glCreateBuffers(1, &SSBO);
+    glNamedBufferData(SSBO, sizeof(float) * vertices.size(), vertices.data(), GL_DYNAMIC_COPY);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, SSBO);
+    glCreateBuffers(1, &record);
+    glNamedBufferData(record, sizeof(uint32_t) * (std::size_t)n * iterations, NULL, GL_DYNAMIC_READ);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, record);
+
+    ComputeShader recorder("shaders/shader.comp", "#define RECORD_MAPS\n");
+    // compute_ifs_shader() advances the seed before using it, the CPU side needs the used one
+    int seed = static_cast<int>(settings.seed);
+    compute_ifs_shader(recorder, fractal, n, iterations, seed);
+    std::vector<uint32_t> gpu((std::size_t)n * iterations);
+    glGetNamedBufferSubData(record, 0, sizeof(uint32_t) * gpu.size(), gpu.data());
+    // one dispatch per iteration has to draw the very same streams
+    int per_iteration_seed = static_cast<int>(settings.seed);
+    compute_ifs_shader(recorder, fractal, n, iterations, per_iteration_seed, false);
+    std::vector<uint32_t> per_iteration(gpu.size());
+    glGetNamedBufferSubData(record, 0, sizeof(uint32_t) * per_iteration.size(), per_iteration.data());
+
+    const double z = 3.719; // one-sided p = 1e-4 per test
+    bool failed = false;
+    auto report = [&](const char *test, bool pass, const std::string &detail){
+        std::printf("%-28s %s  %s\n", test, pass ? "ok  " : "FAIL", detail.c_str());
+        failed |= !pass;
+    };
+    std::printf("%s, %u maps, %u points x %u iterations, seed %d, %s\n", fractal.name.c_str(), maps, n, iterations, seed, context.renderer());
+
+    uint64_t mismatches = 0, pass_mismatches = 0;
+    for(unsigned int i = 0; i < iterations; i++){
+        uint32_t key = rng::stream_key(static_cast<uint32_t>(seed), i);
+        for(unsigned int j = 0; j < n; j++){
+            std::size_t at = (std::size_t)i * n + j;
+            mismatches += gpu[at] != simd_detail::select_map(table, rng::sample(key, j));
+            pass_mismatches += gpu[at] != per_iteration[at];
+        }
+    }
+    report("agreement with CPU", mismatches == 0, std::to_string(mismatches) + " of " + std::to_string(gpu.size()) + " differ");
+    report("single pass = per iteration", pass_mismatches == 0, std::to_string(pass_mismatches) + " differ");
+
+    if(maps < 2){
+        std::printf("a single map leaves nothing random to test\n");
+        return failed ? 1 : 0;
+    }
+    std::vector<double> p = map_probabilities(table);
+
+    // frequencies of every iteration and of all of them together
+    std::vector<uint64_t> counts(maps, 0);
+    double worst = 0.0;
+    unsigned int df = 0;
+    for(unsigned int i = 0; i < iterations; i++){
+        std::vector<uint64_t> iteration_counts(maps, 0);
+        for(unsigned int j = 0; j < n; j++){
+            uint32_t k = gpu[(std::size_t)i * n + j];
+            if(k >= maps){
+                report("frequencies", false, "map index " + std::to_string(k) + " out of range");
+                return 1;
+            }
+            iteration_counts[k]++;
+            counts[k]++;
+        }
+        worst = std::max(worst, chi_square(iteration_counts, p, n, df));
+    }
+    double total_chi = chi_square(counts, p, gpu.size(), df);
+    double critical = df > 0 ? chi_square_critical(df, z) : 0.0;
+    char detail[160];
+    std::snprintf(detail, sizeof(detail), "chi2 %.1f, worst iteration %.1f, critical %.1f (df %u)", total_chi, worst, critical, df);
+    report("frequencies", total_chi < critical && worst < critical, detail);
+
+    // pair tables: (a, b) with a at `first` and b at `second` of every usable position
+    std::vector<double> pair_p(maps * maps);
+    for(unsigned int a = 0; a < maps; a++) for(unsigned int b = 0; b < maps; b++) pair_p[a * maps + b] = p[a] * p[b];
+    auto independence = [&](const char *test, int iteration_lag, int point_lag){
+        std::vector<uint64_t> pairs(maps * maps, 0);
+        uint64_t total = 0;
+        for(unsigned int i = iteration_lag; i < iterations; i++){
+            for(unsigned int j = point_lag; j < n; j++){
+                uint32_t a = gpu[(std::size_t)i * n + j];
+                uint32_t b = gpu[(std::size_t)(i - iteration_lag) * n + (j - point_lag)];
+                pairs[a * maps + b]++;
+                total++;
+            }
+        }
+        unsigned int pair_df = 0;
+        double statistic = chi_square(pairs, pair_p, total, pair_df);
+        double limit = pair_df > 0 ? chi_square_critical(pair_df, z) : 0.0;
+        char text[160];
+        std::snprintf(text, sizeof(text), "chi2 %.1f, critical %.1f (df %u)", statistic, limit, pair_df);
+        report(test, statistic < limit, text);
+    };
+    independence("independence, next point", 0, 1);
+    independence("independence, next iteration", 1, 0);
+    independence("independence, diagonal", 1, 1);
+
+    if(failed) std::cout << "ERROR::RNG_CHECK::FAILED" << std::endl;
+    return failed ? 1 : 0;
+}
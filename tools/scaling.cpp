@@ -0,0 +1,216 @@
+// Thread and problem-size scaling of the CPU backend. For every point count of a decade sweep
+// the kernel runs on the thread pool at every thread count, and the CSV has one row per
+// (points, threads) with the throughput, the speedup and parallel efficiency against one
+// thread at the same size, and the memory bandwidth the run implies:
+//
+//   points,threads,pinned,median_s,stddev_s,points_per_s,speedup,efficiency,bandwidth_gb_s
+//
+// Bandwidth uses the same traffic model as the benchmark tool: a pass over the points reads
+// and writes every coordinate once, fused runs make one pass, --unfused one per iteration.
+// Where efficiency drops while bandwidth flattens is the memory wall of the machine.
+//
+//   akceleracja_scaling --max-points 100000000 --unfused --pin -o scaling.csv
+
+#include <IFS.h>
+#include <PointStore.h>
+#include <ThreadPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct Settings
+{
+    std::string fractal = "sierpinski";
+    std::string kernel = "simd";
+    unsigned int min_points = 10000;
+    unsigned int max_points = 100000000;
+    unsigned int steps_per_decade = 1;
+    unsigned int max_threads = 0;
+    bool every_thread_count = false;
+    unsigned int iterations = 10;
+    bool unfused = false;
+    bool pin = false;
+    unsigned int warmup = 1;
+    unsigned int repetitions = 5;
+    uint32_t seed = 1;
+    std::string output;
+};
+
+void print_usage(const char *name)
+{
+    std::cout << "usage: " << name << " [options]\n"
+              << "  --fractal NAME          sierpinski, barnsley, tetrahedron, random-scaling, random (default sierpinski)\n"
+              << "  --kernel NAME           scalar or simd (default simd)\n"
+              << "  --min-points N          smallest point count (default 10000)\n"
+              << "  --max-points N          largest point count (default 100000000)\n"
+              << "  --steps N               point counts per decade (default 1)\n"
+              << "  --threads N             largest thread count (default: all cores)\n"
+              << "  --every-thread-count    every count from 1 to N instead of powers of two and N\n"
+              << "  --iterations N          iterations per run (default 10)\n"
+              << "  --unfused               stream the whole arrays every iteration\n"
+              << "  --pin                   pin every thread to its own CPU\n"
+              << "  --warmup N              unmeasured runs before the measurements (default 1)\n"
+              << "  --repetitions N         measured runs (default 5)\n"
+              << "  --seed N                RNG seed (default 1)\n"
+              << "  -o, --output FILE       write the CSV to FILE instead of stdout\n";
+}
+
+bool parse_arguments(int argc, char **argv, Settings &settings)
+{
+    for(int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        auto next = [&](unsigned int &value){
+            if(i + 1 >= argc) return false;
+            char *end;
+            unsigned long parsed = std::strtoul(argv[++i], &end, 10);
+            value = static_cast<unsigned int>(parsed);
+            return *end == '\0';
+        };
+        auto next_string = [&](std::string &value){
+            if(i + 1 >= argc) return false;
+            value = argv[++i];
+            return true;
+        };
+        bool ok = true;
+        if(arg == "--fractal") ok = next_string(settings.fractal);
+        else if(arg == "--kernel") ok = next_string(settings.kernel) && (settings.kernel == "scalar" || settings.kernel == "simd");
+        else if(arg == "--min-points") ok = next(settings.min_points) && settings.min_points > 0;
+        else if(arg == "--max-points") ok = next(settings.max_points) && settings.max_points > 0;
+        else if(arg == "--steps") ok = next(settings.steps_per_decade) && settings.steps_per_decade > 0;
+        else if(arg == "--threads") ok = next(settings.max_threads);
+        else if(arg == "--every-thread-count") settings.every_thread_count = true;
+        else if(arg == "--iterations") ok = next(settings.iterations) && settings.iterations > 0;
+        else if(arg == "--unfused") settings.unfused = true;
+        else if(arg == "--pin") settings.pin = true;
+        else if(arg == "--warmup") ok = next(settings.warmup);
+        else if(arg == "--repetitions") ok = next(settings.repetitions) && settings.repetitions > 0;
+        else if(arg == "--seed") ok = next(settings.seed);
+        else if(arg == "-o" || arg == "--output") ok = next_string(settings.output);
+        else ok = false;
+        if(!ok){
+            std::cout << "ERROR::ARGUMENTS: bad or incomplete option " << arg << std::endl;
+            return false;
+        }
+    }
+    return settings.min_points <= settings.max_points;
+}
+
+// min_points * 10^(k / steps) up to max_points, rounded to whole points and deduplicated
+std::vector<unsigned int> point_counts(const Settings &settings)
+{
+    std::vector<unsigned int> counts;
+    for(unsigned int k = 0;; k++){
+        double count = std::round(settings.min_points * std::pow(10.0, (double)k / settings.steps_per_decade));
+        if(count > settings.max_points * (1.0 + 1e-9)) break;
+        if(counts.empty() || counts.back() != (unsigned int)count) counts.push_back((unsigned int)count);
+    }
+    if(counts.back() != settings.max_points) counts.push_back(settings.max_points);
+    return counts;
+}
+
+// 1, 2, 4, ... and the maximum itself, or every count up to it
+std::vector<unsigned int> thread_counts(unsigned int max_threads, bool every)
+{
+    std::vector<unsigned int> counts;
+    for(unsigned int t = 1; t <= max_threads; t = every ? t + 1 : t * 2) counts.push_back(t);
+    if(counts.back() != max_threads) counts.push_back(max_threads);
+    return counts;
+}
+
+int main(int argc, char **argv)
+{
+    Settings settings;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0){
+            print_usage(argv[0]);
+            return 0;
+        }
+    }
+    if(!parse_arguments(argc, argv, settings)){
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::mt19937 generator(settings.seed);
+    IFS fractal;
+    if(!IFS::preset(settings.fractal, fractal, generator)){
+        std::cout << "ERROR::ARGUMENTS: unknown fractal " << settings.fractal << std::endl;
+        return 1;
+    }
+
+    std::ofstream file;
+    if(!settings.output.empty()){
+        file.open(settings.output);
+        if(!file){
+            std::cout << "ERROR::SCALING::FILE_NOT_WRITABLE: " << settings.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream &out = settings.output.empty() ? std::cout : file;
+
+    unsigned int max_threads = settings.max_threads ? settings.max_threads : ThreadPool::default_size();
+    ThreadPool pool(1);
+    pool.set_pinning(settings.pin);
+    SimdLevel level = settings.kernel == "simd" ? simd_level() : SimdLevel::Scalar;
+    IterationOptions options;
+    options.fused = !settings.unfused;
+    double passes = settings.unfused ? settings.iterations : 1.0;
+    double bytes_per_point = passes * 2.0 * fractal.dimensions * sizeof(float);
+
+    std::fprintf(stderr, "%s, %s kernel (%s), %u iterations %s, up to %u threads%s\n", fractal.name.c_str(), settings.kernel.c_str(),
+                 simd_level_name(level), settings.iterations, settings.unfused ? "unfused" : "fused", max_threads, settings.pin ? ", pinned" : "");
+    out << "points,threads,pinned,median_s,stddev_s,points_per_s,speedup,efficiency,bandwidth_gb_s\n";
+
+    uint32_t seed = settings.seed;
+    for(unsigned int count : point_counts(settings)){
+        PointStore points(count, fractal.dimensions);
+        srand(settings.seed);
+        points.generate(0.0f, 1.0f);
+        double single_thread = 0.0;
+        for(unsigned int threads : thread_counts(max_threads, settings.every_thread_count)){
+            pool.resize(threads);
+            auto run = [&]{
+                pool.parallel_for(0, points.size(), PointStore::PADDING, [&](unsigned int begin, unsigned int end, unsigned int){
+                    iterate_blocked(fractal.table(), points, begin, end, settings.iterations, seed, options, level);
+                });
+                seed++;
+            };
+            for(unsigned int w = 0; w < settings.warmup; w++) run();
+            std::vector<double> seconds;
+            for(unsigned int r = 0; r < settings.repetitions; r++){
+                auto start = std::chrono::steady_clock::now();
+                run();
+                seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::sort(seconds.begin(), seconds.end());
+            std::size_t n = seconds.size();
+            double median = n % 2 ? seconds[n / 2] : (seconds[n / 2 - 1] + seconds[n / 2]) / 2;
+            double mean = 0.0, squares = 0.0;
+            for(double s : seconds) mean += s / n;
+            for(double s : seconds) squares += (s - mean) * (s - mean);
+            double stddev = n > 1 ? std::sqrt(squares / (n - 1)) : 0.0;
+
+            if(threads == 1) single_thread = median;
+            double speedup = single_thread / median;
+            double throughput = (double)count * settings.iterations / median;
+            double bandwidth = (double)count * bytes_per_point / median / 1e9;
+            char line[256];
+            std::snprintf(line, sizeof(line), "%u,%u,%d,%.9g,%.9g,%.6g,%.4f,%.4f,%.4f\n", count, threads, settings.pin ? 1 : 0,
+                          median, stddev, throughput, speedup, speedup / threads, bandwidth);
+            out << line << std::flush;
+            std::fprintf(stderr, "%10u points %3u threads: %8.1f Mpoints/s, efficiency %5.1f%%, %6.2f GB/s\n", count, threads,
+                         throughput / 1e6, 100.0 * speedup / threads, bandwidth);
+        }
+    }
+    return 0;
+}